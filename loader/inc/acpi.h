@@ -178,6 +178,11 @@ typedef struct acpi_madt_iso {
  */
 #define ACPI_SRAT_LAPIC_ENABLED     (1 << 0)
 
+// Flags in the memory SRAT entries.
+#define ACPI_SRAT_MEMORY_ENABLED    (1 << 0)    //< the entry is enabled
+#define ACPI_SRAT_MEMORY_HOTPLUG    (1 << 1)    //< the memory is hot-pluggable
+#define ACPI_SRAT_MEMORY_NONVOLATILE (1 << 2)   //< the memory is non-volatile
+
 // SRAT entry types.
 #define ACPI_SRAT_TYPE_LAPIC        0
 #define ACPI_SRAT_TYPE_MEMORY       1
@@ -249,6 +254,191 @@ typedef struct acpi_srat_memory {
     uint64_t reserved2;
 } __attribute__((packed)) acpi_srat_memory_t;
 
+/**
+ * The System Locality Information Table gives the relative distances between
+ * the system's NUMA domains (localities).
+ *
+ * This structure is followed by a locality_count * locality_count matrix of
+ * byte sized distances; the entry at [i * locality_count + j] is the distance
+ * from locality i to locality j. The distance of a locality to itself is
+ * normalized to ten (10), unreachable localities have a distance of 255.
+ */
+typedef struct acpi_slit {
+    acpi_sdt_header_t header;
+
+    uint64_t locality_count;
+} __attribute__((packed)) acpi_slit_t;
+
+// HMAT structure types.
+#define ACPI_HMAT_TYPE_LOCALITY         1
+
+// Memory hierarchy of a HMAT locality structure (lower 4 bits of the flags).
+#define ACPI_HMAT_HIERARCHY_MASK        0xF
+#define ACPI_HMAT_HIERARCHY_MEMORY      0
+
+// Data types of a HMAT locality structure.
+#define ACPI_HMAT_DATA_ACCESS_LATENCY   0
+#define ACPI_HMAT_DATA_READ_LATENCY     1
+#define ACPI_HMAT_DATA_WRITE_LATENCY    2
+#define ACPI_HMAT_DATA_ACCESS_BANDWIDTH 3
+#define ACPI_HMAT_DATA_READ_BANDWIDTH   4
+#define ACPI_HMAT_DATA_WRITE_BANDWIDTH  5
+
+/**
+ * The Heterogeneous Memory Attribute Table describes the latency and bandwidth
+ * between the system's initiator and memory proximity domains.
+ *
+ * This structure is followed by a variable sized list of structures.
+ */
+typedef struct acpi_hmat {
+    acpi_sdt_header_t header;
+
+    uint32_t reserved;
+} __attribute__((packed)) acpi_hmat_t;
+
+/**
+ * Header of a structure in the HMAT.
+ */
+typedef struct acpi_hmat_entry {
+    uint16_t type;
+    uint16_t reserved;
+    uint32_t length;
+} __attribute__((packed)) acpi_hmat_entry_t;
+
+/**
+ * HMAT System Locality Latency and Bandwidth Information structure.
+ *
+ * This structure is followed by the list of initiator proximity domains
+ * (uint32_t[initiator_count]), the list of target proximity domains
+ * (uint32_t[target_count]) and the initiator_count * target_count matrix of
+ * uint16_t entries, which must be multiplied with the base unit to get the
+ * latency in picoseconds or the bandwidth in MB/s. Entries of zero denote
+ * missing information, entries of 0xFFFF unreachable targets.
+ */
+typedef struct acpi_hmat_locality {
+    acpi_hmat_entry_t header;
+
+    uint8_t flags;
+    uint8_t data_type;
+    uint8_t min_transfer_size;
+    uint8_t reserved0;
+    uint32_t initiator_count;
+    uint32_t target_count;
+    uint32_t reserved1;
+    uint64_t base_unit;
+} __attribute__((packed)) acpi_hmat_locality_t;
+
+/**
+ * Generic Address Structure used by ACPI tables to describe registers.
+ */
+typedef struct acpi_gas {
+    uint8_t space_id;
+    uint8_t bit_width;
+    uint8_t bit_offset;
+    uint8_t access_size;
+    uint64_t address;
+} __attribute__((packed)) acpi_gas_t;
+
+// Address space IDs in Generic Address Structures
+#define ACPI_GAS_SPACE_MEMORY       0
+#define ACPI_GAS_SPACE_IO           1
+
+/**
+ * Flag in the FADT indicating that the PM timer is 32 bits wide (default: 24 bits).
+ */
+#define ACPI_FADT_TMR_VAL_EXT       (1 << 8)
+
+/**
+ * Frequency of the ACPI power management timer in Hz.
+ */
+#define ACPI_PM_TIMER_FREQ          3579545
+
+/**
+ * The Fixed ACPI Description Table describes the fixed hardware features of
+ * the platform, such as the power management timer.
+ *
+ * Only the fields up to the extended PM timer block are described; check the
+ * table's length before accessing the extended fields.
+ */
+typedef struct acpi_fadt {
+    acpi_sdt_header_t header;
+
+    uint32_t firmware_ctrl;
+    uint32_t dsdt;
+    uint8_t reserved0;
+    uint8_t preferred_pm_profile;
+    uint16_t sci_int;
+    uint32_t smi_cmd;
+    uint8_t acpi_enable;
+    uint8_t acpi_disable;
+    uint8_t s4bios_req;
+    uint8_t pstate_cnt;
+    uint32_t pm1a_evt_blk;
+    uint32_t pm1b_evt_blk;
+    uint32_t pm1a_cnt_blk;
+    uint32_t pm1b_cnt_blk;
+    uint32_t pm2_cnt_blk;
+    uint32_t pm_tmr_blk;
+    uint32_t gpe0_blk;
+    uint32_t gpe1_blk;
+    uint8_t pm1_evt_len;
+    uint8_t pm1_cnt_len;
+    uint8_t pm2_cnt_len;
+    uint8_t pm_tmr_len;
+    uint8_t gpe0_blk_len;
+    uint8_t gpe1_blk_len;
+    uint8_t gpe1_base;
+    uint8_t cst_cnt;
+    uint16_t p_lvl2_lat;
+    uint16_t p_lvl3_lat;
+    uint16_t flush_size;
+    uint16_t flush_stride;
+    uint8_t duty_offset;
+    uint8_t duty_width;
+    uint8_t day_alrm;
+    uint8_t mon_alrm;
+    uint8_t century;
+    uint16_t iapc_boot_arch;
+    uint8_t reserved1;
+    uint32_t flags;
+    acpi_gas_t reset_reg;
+    uint8_t reset_value;
+    uint16_t arm_boot_arch;
+    uint8_t minor_version;
+    uint64_t x_firmware_ctrl;
+    uint64_t x_dsdt;
+    acpi_gas_t x_pm1a_evt_blk;
+    acpi_gas_t x_pm1b_evt_blk;
+    acpi_gas_t x_pm1a_cnt_blk;
+    acpi_gas_t x_pm1b_cnt_blk;
+    acpi_gas_t x_pm2_cnt_blk;
+    acpi_gas_t x_pm_tmr_blk;
+} __attribute__((packed)) acpi_fadt_t;
+
+/**
+ * The HPET Description Table describes the location of the High Precision
+ * Event Timer's MMIO region.
+ */
+typedef struct acpi_hpet {
+    acpi_sdt_header_t header;
+
+    uint32_t event_timer_block_id;
+    acpi_gas_t base_address;
+    uint8_t hpet_number;
+    uint16_t min_tick;
+    uint8_t page_protection;
+} __attribute__((packed)) acpi_hpet_t;
+
+/**
+ * Pointer to the FADT or null pointer if there is none.
+ */
+extern acpi_fadt_t *acpi_fadt;
+
+/**
+ * Pointer to the HPET table or null pointer if there is none.
+ */
+extern acpi_hpet_t *acpi_hpet;
+
 /**
  * Searches for the RSDP on a 16 byte boundary, given a memory region to
  * search in.
@@ -26,6 +26,19 @@
 #pragma once
 #include <stdint.h>
 
+// CR0 Bits
+#define CPU_CR0_MP          (1 << 1)        //< monitor coprocessor
+#define CPU_CR0_EM          (1 << 2)        //< x87 emulation
+#define CPU_CR0_TS          (1 << 3)        //< task switched
+
+// CR4 Bits
+#define CPU_CR4_PGE         (1 << 7)        //< global pages
+#define CPU_CR4_OSFXSR      (1 << 9)        //< FXSAVE/FXRSTOR and SSE instructions
+#define CPU_CR4_OSXMMEXCPT  (1 << 10)       //< unmasked SIMD exceptions
+#define CPU_CR4_FSGSBASE    (1 << 16)       //< RD/WR FS/GS BASE instructions
+#define CPU_CR4_PCIDE       (1 << 17)       //< process-context identifiers
+#define CPU_CR4_OSXSAVE     (1 << 18)       //< XSAVE and extended state
+
 /**
  * Result of a call to the CPUID instruction. Stores the value of the four
  * general purpose registers eax, ebx, ecx and edx after invocation.
@@ -60,3 +73,71 @@ void cpu_msr_write(uint32_t msr, uint64_t value);
  * @param result output parameter for CPUID result
  */
 void cpu_cpuid(uint32_t code, cpu_cpuid_result_t *result);
+
+/**
+ * Invokes the CPUID instruction for the given code and subleaf (in ECX) and
+ * returns the result in the <result> parameter.
+ *
+ * @param code the CPUID code (in EAX).
+ * @param subleaf the CPUID subleaf (in ECX).
+ * @param result output parameter for CPUID result
+ */
+void cpu_cpuid_sub(uint32_t code, uint32_t subleaf, cpu_cpuid_result_t *result);
+
+/**
+ * Reads the value of the CR0 control register.
+ *
+ * @return the value of CR0
+ */
+uint64_t cpu_cr0_read(void);
+
+/**
+ * Writes a value to the CR0 control register.
+ *
+ * @param value the value to write to CR0
+ */
+void cpu_cr0_write(uint64_t value);
+
+/**
+ * Reads the value of the CR4 control register.
+ *
+ * @return the value of CR4
+ */
+uint64_t cpu_cr4_read(void);
+
+/**
+ * Writes a value to the CR4 control register.
+ *
+ * @param value the value to write to CR4
+ */
+void cpu_cr4_write(uint64_t value);
+
+/**
+ * Writes a value to an extended control register (requires CR4.OSXSAVE).
+ *
+ * @param xcr the index of the XCR to write to
+ * @param value the value to write to the XCR
+ */
+void cpu_xcr_write(uint32_t xcr, uint64_t value);
+
+/**
+ * Arms the address monitoring hardware for the cache line at <address>.
+ *
+ * @param address the address to monitor
+ */
+void cpu_monitor(const volatile void *address);
+
+/**
+ * Waits for a write to the monitored cache line (or an interrupt).
+ *
+ * @param hints the MWAIT hints (target C-state, in EAX)
+ * @param extensions the MWAIT extensions (in ECX)
+ */
+void cpu_mwait(uint32_t hints, uint32_t extensions);
+
+/**
+ * Reads the CPU's time stamp counter.
+ *
+ * @return the value of the time stamp counter
+ */
+uint64_t cpu_tsc_read(void);
@@ -54,6 +54,7 @@
 #define ELF_PT_NOTE             4           //< auxiliary information
 #define ELF_PT_SHLIB            5           //< reserved (not used)
 #define ELF_PT_PHDR             6           //< location of program header itself
+#define ELF_PT_TLS              7           //< thread-local storage template
 
 // Values for elf64_phdr.p_flags
 #define ELF_PF_X                (1 << 0)    //< executable
@@ -193,9 +194,46 @@ elf64_shdr_t *elf64_shdr_find(uint32_t type, void *binary);
  */
 elf64_sym_t *elf64_sym_find(const char *name, void *binary);
 
+/**
+ * Tries to find the first program header of the given <type> in an ELF64
+ * <binary>.
+ *
+ * @param type the segment type to look for
+ * @param binary the ELF64 binary
+ * @return pointer to the program header or null pointer, if there is none
+ */
+elf64_phdr_t *elf64_phdr_find(uint32_t type, void *binary);
+
+/**
+ * Translates a virtual address of an ELF64 <binary> to the address of the
+ * corresponding data in the binary's file image, using its loadable segments.
+ *
+ * Works before the binary has been loaded.
+ *
+ * @param vaddr the virtual address
+ * @param size the size of the data at the address in bytes
+ * @param binary the ELF64 binary
+ * @return pointer into the file image or null pointer, if the data is not
+ *      entirely contained in the file contents of a loadable segment
+ */
+void *elf64_file_address(uint64_t vaddr, size_t size, void *binary);
+
 /**
  * Loads an ELF64 <binary> into virtual memory.
  *
+ * Pages of a loadable segment that are completely backed by the file are
+ * mapped straight from the binary's image, when the segment's offset in the
+ * image and its virtual address are equal modulo the page size. All other
+ * pages, such as the BSS or a partially filled last page, are allocated on
+ * the heap and filled with a copy of the file's contents.
+ *
+ * Segments with an alignment of at least 2 MiB are mapped in place only if
+ * the image has the same offset modulo 2 MiB; otherwise they are copied to
+ * memory that allows them to be mapped with large pages.
+ *
+ * The copies are queued in the work pool, so the loaded image may only be
+ * accessed after pool_wait().
+ *
  * @param binary the binary to load
  */
 void elf64_load(void *binary);
@@ -0,0 +1,52 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// CPUID leaves
+#define FEATURES_LEAF_BASIC         0x01    //< feature information
+#define FEATURES_LEAF_MWAIT         0x05    //< MONITOR/MWAIT parameters
+#define FEATURES_LEAF_EXTENDED      0x07    //< structured extended features
+#define FEATURES_LEAF_XSAVE         0x0D    //< processor extended state
+#define FEATURES_LEAF_FREQUENCY     0x16    //< processor frequency
+#define FEATURES_LEAF_EXT_BASIC     0x80000001
+#define FEATURES_LEAF_EXT_POWER     0x80000007
+
+/**
+ * Takes a snapshot of the CPUID feature words of the current CPU and stores
+ * it in the CPU's entry of the feature table.
+ *
+ * Must be called on every CPU after the CPU table has been built.
+ */
+void features_detect(void);
+
+/**
+ * Computes the feature words that are common to all present CPUs and sets
+ * the HY_INFO_FLAG_HETEROGENEOUS root flag if the CPUs differ.
+ *
+ * Must be called on the BSP after all APs have been booted.
+ */
+void features_merge(void);
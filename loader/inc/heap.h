@@ -26,24 +26,101 @@
 #pragma once
 #include <stdint.h>
 
+/**
+ * Maximum number of reserved regions the heap allocates around.
+ */
+#define HEAP_HOLE_MAX 64
+
+/**
+ * A reserved region of physical memory the heap must not allocate from.
+ */
+typedef struct heap_hole {
+    uintptr_t begin;            //< address of the first byte of the region
+    uintptr_t end;              //< address of the first byte after the region
+} heap_hole_t;
+
 /**
  * Address of the top of the dynamically growing heap. Is always page-aligned.
  */
 extern uintptr_t heap_top;
 
 /**
- * Sets up the heap by finding a top address and moving required data
- * structures behind the top of the heap in order to prevent them from
- * being accidentally overridden.
+ * Number of bytes that have been allocated on the heap so far, including
+ * modules that had to be moved.
+ */
+extern size_t heap_used;
+
+/**
+ * Address of the first byte after the highest module region reserved by
+ * heap_init.
+ */
+extern uintptr_t heap_reserved_end;
+
+/**
+ * Sets up the heap by finding a top address and reserving the regions of the
+ * modules, so they are not overridden by later allocations.
+ *
+ * Modules stay where they have been placed by the bootloader and are marked
+ * in the memory map; only modules overlapping memory owned by Hydrogen are
+ * moved to the heap.
  */
 void heap_init(void);
 
 /**
  * Dynamically allocates a page-aligned chunk of memory.
  *
- * The given size is aligned to the upper page boundary.
+ * The given size is aligned to the upper page boundary. Allocated chunks never
+ * overlap a reserved region. Can be called concurrently by multiple CPUs.
  *
  * @param size the size of the chunk to allocate in bytes
  * @return pointer to the newly allocated chunk
  */
 void *heap_alloc(size_t size);
+
+/**
+ * Allocates a page-aligned chunk of memory on the given NUMA <domain>.
+ *
+ * The chunk is taken from the top of the highest available region of the
+ * domain (according to the NUMA memory table and the memory map; hot-pluggable
+ * ranges are skipped) above the heap, reserved
+ * for the heap and marked in the memory map with HY_INFO_MMAP_FLAG_CPU. Falls
+ * back to heap_alloc, if there is no SRAT, the domain contains the heap or
+ * there is no suitable region.
+ *
+ * Concurrent allocations on the APs are safe, but as the memory map is modified
+ * this must only be called on the BSP.
+ *
+ * @param size the size of the chunk to allocate in bytes
+ * @param domain the id of the NUMA domain
+ * @return pointer to the newly allocated chunk
+ */
+void *heap_alloc_domain(size_t size, uint32_t domain);
+
+/**
+ * Allocates a chunk of <size> bytes for each present CPU on the CPU's NUMA
+ * domain and passes it to <place> together with the CPU's index.
+ *
+ * The chunks of all CPUs in a domain are allocated at once with
+ * heap_alloc_domain and follow each other in the order of the CPU table.
+ *
+ * Must only be called on the BSP.
+ *
+ * @param size the size of each chunk in bytes (a multiple of <align>)
+ * @param align the alignment of the chunks (a power of two, at least 4kB)
+ * @param place function called with the index and the address of each chunk
+ */
+void heap_alloc_cpus(size_t size, size_t align, void (*place)(size_t, uintptr_t));
+
+/**
+ * Dynamically allocates a chunk of memory that is aligned to the given
+ * boundary.
+ *
+ * Behaves like heap_alloc, but the chunk begins on a multiple of <align>,
+ * which must be a power of two and at least the page size. The memory that is
+ * skipped for the alignment is lost.
+ *
+ * @param size the size of the chunk to allocate in bytes
+ * @param align the alignment of the chunk in bytes
+ * @return pointer to the newly allocated chunk
+ */
+void *heap_alloc_aligned(size_t size, size_t align);
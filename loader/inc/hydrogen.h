@@ -51,6 +51,12 @@
  */
 #define HY_MAGIC                0x52445948
 
+/**
+ * Versions of the info table format, as requested in the kernel header.
+ */
+#define HY_INFO_VERSION_1       1
+#define HY_INFO_VERSION_2       2
+
 //-----------------------------------------------------------------------------
 // Info Table - Memory Structure
 //-----------------------------------------------------------------------------
@@ -58,11 +64,23 @@
 #define HY_INFO_OFFSET(name)    ((uintptr_t) (0x14C000 + HY_INFO_ROOT-> name ## _offset))
 
 #define HY_INFO_ROOT            ((hy_info_root_t *) 0x14C000)
-#define HY_INFO_CPU             ((hy_info_cpu_t *) HY_INFO_OFFSET(cpu))
+#define HY_INFO_CPU             ((hy_info_cpu_v1_t *) HY_INFO_OFFSET(cpu))
 #define HY_INFO_IOAPIC          ((hy_info_ioapic_t *) HY_INFO_OFFSET(ioapic))
 #define HY_INFO_MMAP            ((hy_info_mmap_t *) HY_INFO_OFFSET(mmap))
 #define HY_INFO_MODULE          ((hy_info_module_t *) HY_INFO_OFFSET(module))
 #define HY_INFO_STRING          ((char *) HY_INFO_OFFSET(string))
+#define HY_INFO_PHASE           ((hy_info_phase_t *) HY_INFO_OFFSET(phase))
+#define HY_INFO_MILESTONE       ((hy_info_milestone_t *) HY_INFO_OFFSET(milestone))
+#define HY_INFO_NUMA_MEM        ((hy_info_numa_mem_t *) HY_INFO_OFFSET(numa_mem))
+#define HY_INFO_NUMA_DISTANCE   ((uint8_t *) HY_INFO_OFFSET(numa_distance))
+#define HY_INFO_NUMA_PERF       ((hy_info_numa_perf_t *) HY_INFO_OFFSET(numa_perf))
+
+/**
+ * Pointer to a table of the version 2 info tables, given the <root> info table,
+ * the <name> of the table and the <type> of its entries.
+ */
+#define HY_INFO_TABLE(root, name, type) \
+    ((type *) ((uintptr_t) (root) + (root)-> name ## _offset))
 
 //-----------------------------------------------------------------------------
 // Info Table - Flags
@@ -74,12 +92,90 @@
 /** CPU Flag: Set when the CPU entry represents the bootstrap processor. */
 #define HY_INFO_CPU_FLAG_BSP            (1 << 1)
 
+/** CPU Core Type: Hybrid efficiency core (Intel Atom). */
+#define HY_INFO_CPU_CORE_TYPE_ATOM      0x20
+
+/** CPU Core Type: Hybrid performance core (Intel Core). */
+#define HY_INFO_CPU_CORE_TYPE_CORE      0x40
+
+/** Cache Type: Data cache. */
+#define HY_INFO_CACHE_TYPE_DATA         1
+
+/** Cache Type: Instruction cache. */
+#define HY_INFO_CACHE_TYPE_INSTRUCTION  2
+
+/** Cache Type: Unified cache. */
+#define HY_INFO_CACHE_TYPE_UNIFIED      3
+
+/** Cache Flag: The cache is fully associative. */
+#define HY_INFO_CACHE_FLAG_FULLY_ASSOC  (1 << 0)
+
+/** Cache Flag: The cache is inclusive of the lower levels. */
+#define HY_INFO_CACHE_FLAG_INCLUSIVE    (1 << 1)
+
+/** Mailbox State: The CPU is not parked (BSP, non-present CPU or parking disabled). */
+#define HY_INFO_MAILBOX_STATE_NONE      0
+
+/** Mailbox State: The CPU waits for the entry field to be written. */
+#define HY_INFO_MAILBOX_STATE_PARKED    1
+
+/** Mailbox State: The CPU has left its mailbox and entered the kernel. */
+#define HY_INFO_MAILBOX_STATE_RELEASED  2
+
+/** GSI CPU: The GSI is delivered to the lowest priority CPU (or not covered by an IO APIC). */
+#define HY_INFO_GSI_CPU_NONE            0xFFFFFFFF
+
+/** Cache Index: The CPU does not have a cache of this kind. */
+#define HY_INFO_CACHE_NONE              0xFFFF
+
 /** Root Flag: The system has a 8259 PIC. */
 #define HY_INFO_FLAG_PCAT_COMPAT        (1 << 0)
 
 /** Root Flag: The LAPICs are in x2APIC mode. */
 #define HY_INFO_FLAG_X2APIC             (1 << 1)
 
+/** Root Flag: Global pages are enabled (CR4.PGE). */
+#define HY_INFO_FLAG_PGE                (1 << 2)
+
+/** Root Flag: Process-context identifiers are enabled (CR4.PCIDE). */
+#define HY_INFO_FLAG_PCID               (1 << 3)
+
+/** Root Flag: The INVPCID instruction is supported (only set with PCID). */
+#define HY_INFO_FLAG_INVPCID            (1 << 4)
+
+/** Root Flag: The RD/WR FS/GS BASE instructions are enabled (CR4.FSGSBASE). */
+#define HY_INFO_FLAG_FSGSBASE           (1 << 5)
+
+/** Root Flag: The CPUs report different CPUID feature words. */
+#define HY_INFO_FLAG_HETEROGENEOUS      (1 << 6)
+
+/** Root Flag: SSE is enabled on all CPUs (CR4.OSFXSR and CR4.OSXMMEXCPT). */
+#define HY_INFO_FLAG_SSE                (1 << 7)
+
+/** Root Flag: XSAVE is enabled on all CPUs (CR4.OSXSAVE), XCR0 is set to xcr0. */
+#define HY_INFO_FLAG_XSAVE              (1 << 8)
+
+/** MMAP Flag: The region is occupied by a module (see module info table). */
+#define HY_INFO_MMAP_FLAG_MODULE        (1 << 0)
+
+/** MMAP Flag: The region contains page structures of Hydrogen's mapping. */
+#define HY_INFO_MMAP_FLAG_PAGING        (1 << 1)
+
+/** MMAP Flag: The region contains per-CPU data placed on a NUMA domain (e.g. stacks). */
+#define HY_INFO_MMAP_FLAG_CPU           (1 << 2)
+
+/** MMAP Domain: The region is not covered by any memory range of the SRAT. */
+#define HY_INFO_MMAP_DOMAIN_NONE        0xFFFFFFFF
+
+/** NUMA Memory Flag: The memory range is hot-pluggable. */
+#define HY_INFO_NUMA_MEM_FLAG_HOTPLUG       (1 << 0)
+
+/** NUMA Memory Flag: The memory range is non-volatile. */
+#define HY_INFO_NUMA_MEM_FLAG_NONVOLATILE   (1 << 1)
+
+/** NUMA Performance: The target domain is unreachable from the initiator. */
+#define HY_INFO_NUMA_PERF_UNREACHABLE       0xFFFFFFFF
+
 /** IRQ Flag: The IRQ's interrupt line is active low (default: active high). */
 #define HY_INFO_IRQ_FLAG_ACTIVE_LOW     (1 << 0)
 
@@ -122,24 +218,262 @@ typedef struct hy_info_root {
     uint16_t ioapic_count;      //< number of IO APICs
     uint16_t mmap_count;        //< number of entries in the memory map
     uint16_t module_count;      //< number of modules
+
+    uint16_t phase_offset;      //< offset of the boot phase table
+    uint16_t milestone_offset;  //< offset of the CPU milestone table
+    uint16_t phase_count;       //< number of entries in the boot phase table
+
+    uint64_t boot_tsc;          //< TSC value on the BSP when Hydrogen was entered
+    uint64_t pages_mapped;      //< number of pages mapped by Hydrogen
+    uint64_t bytes_copied;      //< number of bytes copied by Hydrogen
+    uint64_t heap_used;         //< number of bytes allocated on Hydrogen's heap
+    uint64_t copy_cycles;       //< number of TSC ticks spent copying bytes_copied
+    uint64_t identity_length;   //< length of the identity mapping in bytes
+    uint64_t map_cycles;        //< number of TSC ticks spent mapping pages_mapped
+
+    uint16_t numa_mem_offset;   //< offset of the NUMA memory table
+    uint16_t numa_mem_count;    //< number of entries in the NUMA memory table
+    uint16_t numa_domain_count; //< number of NUMA domains
+    uint16_t numa_distance_offset; //< offset of the NUMA distance matrix (or zero)
+    uint16_t numa_perf_offset;  //< offset of the NUMA performance matrix (or zero)
     
 } __attribute__((packed)) hy_info_root_t;
 
+/**
+ * Root info table of the version 2 info table format.
+ *
+ * All offsets are relative to the root info table and all tables are aligned
+ * to 64 bytes. New fields and tables are only added to this format.
+ */
+typedef struct hy_info_root_v2 {
+
+    uint32_t magic;             //< a magic number (HY_MAGIC)
+    uint32_t version;           //< version of the format (HY_INFO_VERSION_2)
+    uint32_t length;            //< length of the info tables, including the root
+    uint32_t flags;             //< flags
+
+    uint64_t lapic_paddr;       //< physical address of the LAPIC MMIO window
+    uint64_t rsdp_paddr;        //< physical address of the RSDP (ACPI)
+    uint64_t idt_paddr;         //< physical address of the IDT
+    uint64_t gdt_paddr;         //< physical address of the GDT
+    uint64_t tss_paddr;         //< physical address of the TSS entries
+    uint64_t free_paddr;        //< physical address of the first free to use byte
+
+    uint64_t boot_tsc;          //< TSC value on the BSP when Hydrogen was entered
+    uint64_t pages_mapped;      //< number of pages mapped by Hydrogen
+    uint64_t bytes_copied;      //< number of bytes copied by Hydrogen
+    uint64_t heap_used;         //< number of bytes allocated on Hydrogen's heap
+    uint64_t copy_cycles;       //< number of TSC ticks spent copying bytes_copied
+    uint64_t identity_length;   //< length of the identity mapping in bytes
+    uint64_t map_cycles;        //< number of TSC ticks spent mapping pages_mapped
+
+    uint32_t irq_gsi[16];       //< map of ISR IRQ numbers to GSI numbers
+    uint8_t irq_flags[16];      //< flags regarding the IRQs
+
+    uint32_t cpu_offset;        //< offset of the CPU table
+    uint32_t cpu_count;         //< number of entries in the CPU table
+    uint32_t cpu_count_active;  //< number of active CPUs in the system
+    uint32_t cpu_index_offset;  //< offset of the APIC id index of the CPU table
+    uint32_t milestone_offset;  //< offset of the CPU milestone table
+
+    uint32_t ioapic_offset;     //< offset of the IO APIC table
+    uint32_t ioapic_count;      //< number of IO APICs
+    uint32_t mmap_offset;       //< offset of the MMAP table
+    uint32_t mmap_count;        //< number of entries in the memory map
+    uint32_t module_offset;     //< offset of the module table (hy_info_module_v2_t)
+    uint32_t module_count;      //< number of modules
+    uint32_t string_offset;     //< offset of the string table
+    uint32_t string_length;     //< length of the string table in bytes
+    uint32_t phase_offset;      //< offset of the boot phase table (hy_info_phase_v2_t)
+    uint32_t phase_count;       //< number of entries in the boot phase table
+
+    uint32_t numa_mem_offset;   //< offset of the NUMA memory table
+    uint32_t numa_mem_count;    //< number of entries in the NUMA memory table
+    uint32_t numa_domain_count; //< number of NUMA domains
+    uint32_t numa_distance_offset; //< offset of the NUMA distance matrix (or zero)
+    uint32_t numa_perf_offset;  //< offset of the NUMA performance matrix (or zero)
+
+    uint32_t core_count;        //< number of cores with present CPUs
+    uint32_t package_count;     //< number of packages with present CPUs
+
+    uint32_t cache_offset;      //< offset of the cache table
+    uint32_t cache_count;       //< number of entries in the cache table
+
+    uint32_t cpu_features_offset; //< offset of the CPU feature table (indexed like the CPU table)
+    uint32_t cpu_features_common_offset; //< offset of the features common to all CPUs
+
+    uint64_t xcr0;              //< value of XCR0 on all CPUs (or zero without XSAVE)
+    uint32_t xsave_size;        //< size of the FXSAVE/XSAVE area in bytes (or zero without SSE)
+
+    uint32_t gsi_cpu_offset;    //< offset of the GSI to CPU table (uint32_t CPU table indices)
+    uint32_t gsi_count;         //< number of entries in the GSI to CPU table
+
+    uint32_t cluster_offset;    //< offset of the logical cluster table
+    uint32_t cluster_count;     //< number of entries in the logical cluster table
+
+    uint32_t mailbox_offset;    //< offset of the AP mailbox table (indexed like the CPU table)
+    uint32_t work_offset;       //< offset of the boot work statistics table (indexed like the CPU table)
+
+} __attribute__((packed)) hy_info_root_v2_t;
+
+/**
+ * An entry in the CPU info table of the version 1 format, which is indexed by
+ * the APIC id of the CPU.
+ * 
+ * Without the HY_INFO_CPU_PRESENT flag being set, the CPU entry can be ignored.
+ * 
+ * Length: 18 bytes.
+ */
+typedef struct hy_info_cpu_v1 {
+    uint32_t apic_id;           //< apic id of the CPU's LAPIC
+    uint32_t acpi_id;           //< acpi id of the CPU
+    uint16_t flags;             //< CPU flags
+    uint32_t lapic_timer_freq;  //< lapic timer ticks per second
+    uint32_t domain;            //< which NUMA domain the CPU belongs to
+} __attribute__((packed)) hy_info_cpu_v1_t;
+
 /**
  * An entry in the CPU info table which represents a single CPU in the system.
  * 
  * Without the HY_INFO_CPU_PRESENT flag being set, the CPU entry can be ignored.
+ * The entries are cache line sized and the table is cache line aligned, so
+ * each CPU can update its own entry without disturbing the others.
  * 
- * Length: 17 bytes.
+ * Length: 64 bytes.
  */
 typedef struct hy_info_cpu {
     uint32_t apic_id;           //< apic id of the CPU's LAPIC
     uint32_t acpi_id;           //< acpi id of the CPU
+    uint32_t domain;            //< which NUMA domain the CPU belongs to
     uint16_t flags;             //< CPU flags
+    uint16_t cluster;           //< x2APIC cluster id (zero in xAPIC mode)
+    uint64_t tsc_freq;          //< time stamp counter ticks per second
     uint32_t lapic_timer_freq;  //< lapic timer ticks per second
-    uint32_t domain;            //< which NUMA domain the CPU belongs to
+    uint32_t logical_id;        //< logical destination (x2APIC LDR or xAPIC flat bit)
+    uint32_t package_id;        //< system-wide package id (from the APIC id)
+    uint32_t die_id;            //< system-wide die id (equals package id without dies)
+    uint32_t core_id;           //< system-wide core id (from the APIC id)
+    uint16_t smt_id;            //< SMT thread id within the core
+    uint8_t core_type;          //< hybrid core type (or zero)
+    uint8_t padding2;
+    uint32_t core_index;        //< dense index of the core (SMT siblings share it)
+    uint32_t package_index;     //< dense index of the package
+    uint16_t cache_l1d;         //< index of the L1 data cache (version 2 only)
+    uint16_t cache_l1i;         //< index of the L1 instruction cache (version 2 only)
+    uint16_t cache_l2;          //< index of the L2 cache (version 2 only)
+    uint16_t cache_llc;         //< index of the last level cache (version 2 only)
 } __attribute__((packed)) hy_info_cpu_t;
 
+/**
+ * An entry in the APIC id index of the CPU table, which maps an APIC id to the
+ * index of the CPU's entry in the CPU table. The index is sorted by APIC id.
+ *
+ * Length: 8 bytes.
+ */
+typedef struct hy_info_cpu_index {
+    uint32_t apic_id;           //< apic id of the CPU's LAPIC
+    uint32_t index;             //< index of the CPU in the CPU table
+} __attribute__((packed)) hy_info_cpu_index_t;
+
+/**
+ * An entry in the AP mailbox table, in which a parked AP waits to be released
+ * by the kernel.
+ *
+ * The kernel releases the AP by writing stack and argument first and then a
+ * non-zero entry address. The entries are cache line sized and the table is
+ * cache line aligned, so each AP monitors its own line.
+ *
+ * Length: 64 bytes.
+ */
+typedef struct hy_info_mailbox {
+    volatile uint64_t entry;    //< address to enter the kernel at (zero while parked)
+    volatile uint64_t stack;    //< top of the stack to enter with (or zero for the CPU's stack)
+    volatile uint64_t argument; //< value passed in RSI
+    volatile uint32_t state;    //< mailbox state (HY_INFO_MAILBOX_STATE_*)
+    uint32_t padding0;
+    uint64_t reserved[4];       //< reserved for future use (zero)
+} __attribute__((packed)) hy_info_mailbox_t;
+
+/**
+ * An entry in the boot work statistics table, which records the bulk copy and
+ * zero jobs the CPU has executed for the loader's work pool during boot.
+ *
+ * Length: 64 bytes.
+ */
+typedef struct hy_info_work {
+    uint64_t jobs;              //< number of jobs executed
+    uint64_t bytes;             //< number of bytes copied or zeroed
+    uint64_t cycles;            //< TSC ticks spent executing jobs
+    uint64_t reserved[5];       //< reserved for future use (zero)
+} __attribute__((packed)) hy_info_work_t;
+
+/**
+ * An entry in the logical cluster table which represents a cluster of CPUs
+ * that can be addressed at once with a logical destination.
+ *
+ * The CPUs of the cluster are the present CPUs in the range of the APIC id
+ * index that starts at cpu_first and has cpu_count entries.
+ *
+ * Length: 16 bytes.
+ */
+typedef struct hy_info_cluster {
+    uint32_t cluster;           //< x2APIC cluster id (zero in xAPIC mode)
+    uint32_t logical_mask;      //< or-ed logical bits of the cluster's present CPUs
+    uint32_t cpu_first;         //< first APIC id index entry of the cluster's CPUs
+    uint32_t cpu_count;         //< number of APIC id index entries of the cluster's CPUs
+} __attribute__((packed)) hy_info_cluster_t;
+
+/**
+ * A snapshot of the CPUID feature words and power management parameters of a
+ * CPU, as stored in the CPU feature table.
+ *
+ * The first twelve fields are the feature words, which are and-ed over all
+ * present CPUs for the common features.
+ *
+ * Length: 64 bytes.
+ */
+typedef struct hy_info_cpu_features {
+    uint32_t basic_ecx;         //< CPUID 0x01 ECX
+    uint32_t basic_edx;         //< CPUID 0x01 EDX
+    uint32_t extended_ebx;      //< CPUID 0x07.0 EBX
+    uint32_t extended_ecx;      //< CPUID 0x07.0 ECX
+    uint32_t extended_edx;      //< CPUID 0x07.0 EDX
+    uint32_t extended_1_eax;    //< CPUID 0x07.1 EAX
+    uint32_t xsave_mask_low;    //< CPUID 0x0D.0 EAX (supported XCR0 bits)
+    uint32_t xsave_mask_high;   //< CPUID 0x0D.0 EDX (supported XCR0 bits)
+    uint32_t xsave_features;    //< CPUID 0x0D.1 EAX
+    uint32_t ext_ecx;           //< CPUID 0x80000001 ECX
+    uint32_t ext_edx;           //< CPUID 0x80000001 EDX
+    uint32_t power_edx;         //< CPUID 0x80000007 EDX (bit 8: invariant TSC)
+    uint16_t mwait_line_min;    //< smallest monitor line size in bytes
+    uint16_t mwait_line_max;    //< largest monitor line size in bytes
+    uint32_t mwait_flags;       //< CPUID 0x05 ECX
+    uint32_t mwait_substates;   //< CPUID 0x05 EDX (C-state sub-states)
+    uint16_t base_mhz;          //< base frequency in MHz (or zero)
+    uint16_t max_mhz;           //< maximum frequency in MHz (or zero)
+} __attribute__((packed)) hy_info_cpu_features_t;
+
+/**
+ * An entry in the cache table which represents a single cache instance, as
+ * reported by CPUID leaf 4 (or 0x8000001D).
+ *
+ * The CPUs sharing the cache are the present CPUs in the range of the APIC id
+ * index that starts at cpu_first and has cpu_count entries.
+ *
+ * Length: 32 bytes.
+ */
+typedef struct hy_info_cache {
+    uint8_t level;              //< cache level (1 for L1)
+    uint8_t type;               //< cache type (HY_INFO_CACHE_TYPE_*)
+    uint16_t flags;             //< cache flags
+    uint32_t line_size;         //< line size in bytes
+    uint32_t ways;              //< ways of associativity
+    uint32_t sets;              //< number of sets
+    uint64_t size;              //< total size in bytes
+    uint32_t cpu_first;         //< first APIC id index entry of the sharing CPUs
+    uint32_t cpu_count;         //< number of APIC id index entries of the sharing CPUs
+} __attribute__((packed)) hy_info_cache_t;
+
 /**
  * An entry in the IO APIC info table which represents a single IO APIC that
  * is installed into the system and that covers a given interval of GSIs.
@@ -164,7 +498,8 @@ typedef struct hy_info_mmap {
     uint64_t address;           //< physical address the region begins on
     uint64_t length;            //< length of the region in bytes
     uint64_t available;         //< one if available, zero otherwise
-    uint64_t padding;
+    uint32_t flags;             //< flags regarding the region's usage
+    uint32_t domain;            //< id of the NUMA domain the region belongs to (or HY_INFO_MMAP_DOMAIN_NONE)
 } __attribute__((packed)) hy_info_mmap_t;
 
 /**
@@ -179,6 +514,85 @@ typedef struct hy_info_module {
     uint16_t padding;
 } __attribute__((packed)) hy_info_module_t;
 
+/**
+ * An entry in the module list of the version 2 info table format.
+ *
+ * Length: 24 bytes.
+ */
+typedef struct hy_info_module_v2 {
+    uint64_t address;           //< physical address of the module
+    uint64_t length;            //< length of the module in bytes
+    uint32_t name;              //< offset of the name in the string table
+    uint32_t padding;
+} __attribute__((packed)) hy_info_module_v2_t;
+
+/**
+ * An entry in the NUMA memory table, which associates a range of physical
+ * memory with a NUMA domain, as described by the SRAT.
+ *
+ * Length: 24 bytes.
+ */
+typedef struct hy_info_numa_mem {
+    uint64_t address;           //< physical address the range begins on
+    uint64_t length;            //< length of the range in bytes
+    uint32_t domain;            //< id of the NUMA domain
+    uint32_t flags;             //< flags
+} __attribute__((packed)) hy_info_numa_mem_t;
+
+/**
+ * An entry in the NUMA performance matrix, which describes the latency and
+ * bandwidth of accesses from an initiator domain to the memory of a target
+ * domain, as described by the HMAT.
+ *
+ * Values of zero have not been provided by the firmware.
+ *
+ * Length: 16 bytes.
+ */
+typedef struct hy_info_numa_perf {
+    uint32_t read_latency;      //< read latency in picoseconds
+    uint32_t write_latency;     //< write latency in picoseconds
+    uint32_t read_bandwidth;    //< read bandwidth in MB/s
+    uint32_t write_bandwidth;   //< write bandwidth in MB/s
+} __attribute__((packed)) hy_info_numa_perf_t;
+
+/**
+ * An entry in the boot phase table, which marks the completion of a phase of
+ * Hydrogen's startup process on the BSP.
+ *
+ * Length: 16 bytes.
+ */
+typedef struct hy_info_phase {
+    uint64_t tsc;               //< TSC value on the BSP when the phase was completed
+    uint16_t name;              //< offset of the phase's name in the string table
+    uint16_t padding[3];
+} __attribute__((packed)) hy_info_phase_t;
+
+/**
+ * An entry in the boot phase table of the version 2 info table format.
+ *
+ * Length: 16 bytes.
+ */
+typedef struct hy_info_phase_v2 {
+    uint64_t tsc;               //< TSC value on the BSP when the phase was completed
+    uint32_t name;              //< offset of the phase's name in the string table
+    uint32_t padding;
+} __attribute__((packed)) hy_info_phase_v2_t;
+
+/**
+ * An entry in the CPU milestone table, which records the TSC values of a
+ * CPU at several points during its startup. The milestone table is indexed
+ * the same way as the CPU table; entries of the BSP and of non-present CPUs
+ * are zero.
+ *
+ * Length: 32 bytes.
+ */
+typedef struct hy_info_milestone {
+    uint64_t trampoline_tsc;    //< the CPU entered the real mode trampoline
+    uint64_t entry_tsc;         //< the CPU entered long mode
+    uint64_t calibrated_tsc;    //< the CPU calibrated its LAPIC timer
+    uint64_t release_tsc;       //< the CPU has been released from the entry barrier
+} __attribute__((packed)) hy_info_milestone_t;
+
 //-----------------------------------------------------------------------------
 // Kernel Header - Symbol Names
 //-----------------------------------------------------------------------------
@@ -199,6 +613,42 @@ typedef struct hy_info_module {
 /** Root Flag: Require X2APIC support, fail otherwise. X2APIC_ALLOW must be set. */
 #define HY_HEADER_FLAG_X2APIC_REQUIRE   (1 << 2)
 
+/** Root Flag: Enable process-context identifiers (CR4.PCIDE), if available. */
+#define HY_HEADER_FLAG_PCID_ALLOW       (1 << 3)
+
+/** Root Flag: Enable the RD/WR FS/GS BASE instructions (CR4.FSGSBASE), if available. */
+#define HY_HEADER_FLAG_FSGSBASE_ALLOW   (1 << 4)
+
+/** Root Flag: Take the per-CPU area's template from the kernel's PT_TLS segment. */
+#define HY_HEADER_FLAG_PERCPU_TLS       (1 << 5)
+
+/** Root Flag: Point the FS base to the per-CPU area as well. */
+#define HY_HEADER_FLAG_PERCPU_FS        (1 << 6)
+
+/** Root Flag: Enable SSE (CR4.OSFXSR and CR4.OSXMMEXCPT) on all CPUs. */
+#define HY_HEADER_FLAG_SSE_ENABLE       (1 << 7)
+
+/** Root Flag: Enable XSAVE (CR4.OSXSAVE) with the xcr0_mask state components, if available. SSE_ENABLE must be set. */
+#define HY_HEADER_FLAG_XSAVE_ENABLE     (1 << 8)
+
+/** Root Flag: Park the APs in their mailboxes instead of entering ap_entry (requires info format 2). */
+#define HY_HEADER_FLAG_AP_PARK          (1 << 9)
+
+/** IRQ Policy: Lowest priority delivery to all CPUs (or to the BSP with IOAPIC_BSP). */
+#define HY_HEADER_IRQ_POLICY_DEFAULT    0
+
+/** IRQ Policy: Fixed delivery, GSIs spread round-robin over the cores. */
+#define HY_HEADER_IRQ_POLICY_ROUND_ROBIN 1
+
+/** IRQ Policy: Fixed delivery, GSIs spread over the cores in the IO APIC's NUMA domain. */
+#define HY_HEADER_IRQ_POLICY_NUMA       2
+
+/** IRQ Policy: Fixed delivery to the CPUs given in the kernel's GSI to APIC id table. */
+#define HY_HEADER_IRQ_POLICY_TABLE      3
+
+/** IRQ CPU Table: Route the GSI round-robin. */
+#define HY_HEADER_IRQ_CPU_DEFAULT       0xFFFFFFFF
+
 /** IRQ Flag: The IRQ should be masked when the kernel is entered. */
 #define HY_HEADER_IRQ_FLAG_MASK         (1 << 0)
 
@@ -236,4 +686,21 @@ typedef struct hy_header_root {
     uint64_t isr_entry_table;   //< ISR entry table pointer (or null)
 
     hy_header_irq_t irqs[16];   //< IRQ configuration
+
+    uint64_t stack_size;        //< size of each CPU's stack in bytes (or zero for 4kB)
+    uint64_t stack_guard;       //< number of unmapped guard pages below each virtual stack
+
+    uint64_t percpu_size;       //< size of each CPU's per-CPU area in bytes (or zero for none)
+    uint64_t percpu_align;      //< alignment of the per-CPU areas in bytes (or zero)
+    uint64_t percpu_template;   //< virtual address of the per-CPU area's template (or null)
+    uint64_t percpu_template_size; //< size of the template in bytes
+    uint64_t percpu_vaddr;      //< virtual address for the per-CPU areas (or null)
+
+    uint32_t info_version;      //< info table format version (HY_INFO_VERSION_*, zero for 1)
+
+    uint64_t xcr0_mask;         //< XCR0 state components to enable with XSAVE_ENABLE
+
+    uint32_t irq_policy;        //< GSI routing policy (HY_HEADER_IRQ_POLICY_*)
+    uint32_t irq_cpu_count;     //< number of entries in the GSI to APIC id table
+    uint64_t irq_cpu_table;     //< virtual address of the GSI to APIC id table (uint32_t, or null)
 } __attribute__((packed)) hy_header_root_t;
@@ -33,15 +33,95 @@
 #define INFO_SECTION __attribute__((section (".info")))
 
 /**
- * Pointer to the root structure of the info section.
+ * Pointer to the root structure of the info tables Hydrogen works on.
+ *
+ * The tables are built in the version 2 format and are copied to their final
+ * place in the format requested by the kernel by info_copy(). Until then the
+ * offset and length fields of the root are not set.
  */
-extern hy_info_root_t *info_root;
+extern hy_info_root_v2_t *info_root;
+
+/**
+ * The size of the area at the fixed address 0x14C000 in which the root info
+ * table and all other info tables of the version 1 format must be placed, so
+ * they can be reached with the 16 bit offsets in the root.
+ */
+#define INFO_WINDOW_SIZE 0xF000
+
+/**
+ * Number of entries reserved in the final memory map for the splits of the
+ * regions that are marked after the tables have been placed.
+ */
+#define INFO_MMAP_RESERVE 64
+
+/**
+ * Initial size of the string table in bytes.
+ */
+#define INFO_STRING_SIZE 0x1000
+
+/**
+ * Maximum number of entries in the boot phase table.
+ */
+#define INFO_PHASE_MAX 32
+
+/**
+ * Maximum number of NUMA domains for which the distance and performance
+ * matrices are exported.
+ */
+#define INFO_NUMA_DOMAIN_MAX 32
+
 
 /**
  * Pointer to the CPU list of the info section.
  */
 extern hy_info_cpu_t *info_cpu;
 
+/**
+ * Pointer to the APIC id index of the CPU list of the info section.
+ */
+extern hy_info_cpu_index_t *info_cpu_index;
+
+/**
+ * Index returned by info_cpu_find() for unknown APIC ids.
+ */
+#define INFO_CPU_NONE ((size_t) -1)
+
+/**
+ * Pointer to the CPU feature table of the info section.
+ */
+extern hy_info_cpu_features_t *info_cpu_features;
+
+/**
+ * Pointer to the features common to all CPUs.
+ */
+extern hy_info_cpu_features_t *info_cpu_features_common;
+
+/**
+ * Pointer to the AP mailbox table of the info section (the final one, after
+ * info_copy()).
+ */
+extern hy_info_mailbox_t *info_mailbox;
+
+/**
+ * Pointer to the boot work statistics table of the info section.
+ */
+extern hy_info_work_t *info_work;
+
+/**
+ * Pointer to the logical cluster table of the info section.
+ */
+extern hy_info_cluster_t *info_cluster;
+
+/**
+ * Pointer to the GSI to CPU table of the info section.
+ */
+extern uint32_t *info_gsi_cpu;
+
+/**
+ * Pointer to the cache table of the info section.
+ */
+extern hy_info_cache_t *info_cache;
+
 /**
  * Pointer to the IO APIC list of the info section.
  */
@@ -55,27 +135,50 @@ extern hy_info_mmap_t *info_mmap;
 /**
  * Pointer to the module list of the info section.
  */
-extern hy_info_module_t *info_module;
+extern hy_info_module_v2_t *info_module;
+
+/**
+ * Pointer to the NUMA memory table of the info section.
+ */
+extern hy_info_numa_mem_t *info_numa_mem;
+
+/**
+ * Pointer to the NUMA distance matrix of the info section.
+ */
+extern uint8_t *info_numa_distance;
+
+/**
+ * Pointer to the NUMA performance matrix of the info section.
+ */
+extern hy_info_numa_perf_t *info_numa_perf;
+
+/**
+ * Pointer to the boot phase table of the info section.
+ */
+extern hy_info_phase_v2_t *info_phase_table;
+
+/**
+ * Pointer to the CPU milestone table of the info section.
+ */
+extern hy_info_milestone_t *info_milestone;
 
 /**
  * Pointer to the string table of the info section.
+ *
+ * The string table is moved when it grows, so strings must be referenced by
+ * their offset in the table.
  */
 extern char *info_strings;
 
 /**
- * Pointer to the place to put the next string to.
+ * Physical address of the final info tables (or zero, if not placed yet).
  */
-extern char *info_strings_next;
+extern uintptr_t info_final;
 
 /**
- * Space that is left in the string table (in bytes).
+ * Size of the final info tables in bytes.
  */
-extern uint32_t info_string_space;
-
-// Linker symbols that specify the beginning and
-// the end of the info tables in memory
-extern uint8_t info_begin;
-extern uint8_t info_end;
+extern size_t info_final_size;
 
 /**
  * Prepares the info structure by filling it with reasonable defaults.
@@ -83,20 +186,153 @@ extern uint8_t info_end;
 void info_init(void);
 
 /**
- * Copies the tables to the target location and compacts them to the given size.
- * 
- * Panics, if the size does not suffice for storing the tables.
- * 
- * @param target
+ * Allocates a zeroed table of the given <size> (in bytes) in the info section,
+ * or on the heap once the info section is exhausted and the heap is set up.
+ *
+ * The table is aligned to and padded to a multiple of the cache line size.
+ *
+ * Panics, when running out of space before the heap is set up.
+ *
+ * @param size the size of the table to allocate
+ * @return pointer to the allocated table
  */
-void info_copy(void *target, size_t size);
+void *info_alloc(size_t size);
+
+/**
+ * Allocates the memory map with space for <count> entries.
+ *
+ * The memory map grows as entries are split, so the count is only a hint.
+ *
+ * @param count the initial number of entries
+ */
+void info_mmap_alloc(size_t count);
+
+/**
+ * Allocates the module table with space for <count> modules.
+ *
+ * @param count the number of modules
+ */
+void info_module_alloc(size_t count);
+
+/**
+ * Allocates the IO APIC table with space for <count> IO APICs.
+ *
+ * @param count the number of IO APICs
+ */
+void info_ioapic_alloc(size_t count);
+
+/**
+ * Allocates the CPU table, its APIC id index and the tables indexed like it
+ * (milestones, features, mailboxes and work statistics) with space for <count> CPUs.
+ *
+ * @param count the maximum number of CPUs
+ */
+void info_cpu_alloc(size_t count);
+
+/**
+ * Allocates the cache table with space for <count> cache instances.
+ *
+ * @param count the number of cache instances
+ */
+void info_cache_alloc(size_t count);
+
+/**
+ * Allocates the GSI to CPU table with space for <count> GSIs.
+ *
+ * @param count the number of GSIs
+ */
+void info_gsi_cpu_alloc(size_t count);
+
+/**
+ * Allocates the logical cluster table with space for <count> clusters.
+ *
+ * @param count the number of clusters
+ */
+void info_cluster_alloc(size_t count);
+
+/**
+ * Appends a CPU with the given <apic_id> to the CPU table and inserts it into
+ * the APIC id index.
+ *
+ * @param apic_id the APIC id of the CPU
+ * @return the CPU's entry or a null pointer, if the APIC id is already known
+ */
+hy_info_cpu_t *info_cpu_add(uint32_t apic_id);
+
+/**
+ * Looks up the index of the CPU with the given <apic_id> in the CPU table.
+ *
+ * @param apic_id the APIC id of the CPU
+ * @return the index of the CPU or INFO_CPU_NONE, if there is no such CPU
+ */
+size_t info_cpu_find(uint32_t apic_id);
+
+/**
+ * Marks the page aligned region that covers [<begin>, <end>) as unavailable
+ * in the memory map and sets the given <flags> on it.
+ *
+ * Available entries that partially overlap the region are split.
+ *
+ * @param begin the address of the first byte of the region
+ * @param end the address of the first byte after the region
+ * @param flags the flags to set on the region (HY_INFO_MMAP_FLAG_*)
+ */
+void info_mmap_mark(uintptr_t begin, uintptr_t end, uint32_t flags);
+
+/**
+ * Splits the memory map at the boundaries of the ranges in the NUMA memory
+ * table and sets the domain of each entry that lies within a range.
+ */
+void info_mmap_domains(void);
+
+/**
+ * Marks the completion of a boot phase in the boot phase table by recording
+ * the current TSC value together with the phase's <name>.
+ *
+ * Must only be called on the BSP. Phases beyond INFO_PHASE_MAX are dropped.
+ *
+ * @param name the name of the completed phase
+ */
+void info_phase(const char *name);
+
+/**
+ * Determines the size of the info tables in the given format <version> and
+ * reserves the memory for the final tables: the fixed area at 0x14C000 for
+ * version 1 (panics if the tables do not fit) or a chunk on the heap for
+ * version 2. Sets info_final and info_final_size accordingly.
+ *
+ * Must be called on the BSP after the last boot phase has been completed.
+ *
+ * @param version the format version (HY_INFO_VERSION_*, zero for version 1)
+ */
+void info_place(uint32_t version);
+
+/**
+ * Copies the info tables to the place reserved by info_place() and converts
+ * them to the requested format.
+ *
+ * Afterwards info_milestone points to the final milestone table, so the APs
+ * can record their release from the entry barrier (see info_milestone_final()). Panics, if the memory map
+ * has grown beyond its reserve since the tables have been placed.
+ */
+void info_copy(void);
+
+/**
+ * Returns the entry of the CPU with the given <index> in the CPU info table in
+ * the final milestone table, which is indexed by APIC id in the version 1
+ * format. Must be called after info_copy().
+ *
+ * @param index the index of the CPU in the CPU info table
+ * @return the CPU's final milestone entry
+ */
+hy_info_milestone_t *info_milestone_final(size_t index);
 
 /**
  * Allocates space for a string, given its length.
  * 
- * The given length does not include the terminating zero byte.
- * 
- * Panics, when running out of space in the string table.
+ * The given length does not include the terminating zero byte. The string
+ * table grows when it runs out of space, which invalidates all pointers
+ * previously returned by this function.
  * 
  * @param length the length of the string to allocate.
  * @return pointer to the allocate string
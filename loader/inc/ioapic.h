@@ -72,19 +72,18 @@
 /**
  * Default redirection entry for kernel setup.
  *
- * Delivery to lowest priority CPU. Vector must be OR'ed.
+ * Delivery to lowest priority CPU. Vector and logical destination must be OR'ed.
  */
 #define IOAPIC_REDIR_KERNEL                                ( \
         (APIC_DELIVERY_LOW_PRIO << IOAPIC_REDIR_DVL_MODE)   | \
-        (APIC_MODE_LOGICAL      << IOAPIC_REDIR_DEST_MODE)  | \
-        ((uint64_t) 0xFF        << IOAPIC_REDIR_DEST)       )
+        (APIC_MODE_LOGICAL      << IOAPIC_REDIR_DEST_MODE)  )
 
 /**
- * Default redirection entry for kernel setup (with single IOAPIC BSP flag).
+ * Redirection entry for kernel setup with a GSI routed to a single CPU.
  *
- * Delivery to a single CPU. Vector must be OR'ed.
+ * Delivery to a single CPU. Vector and destination must be OR'ed.
  */
-#define IOAPIC_REDIR_KERNEL_BSP                            ( \
+#define IOAPIC_REDIR_KERNEL_FIXED                          ( \
         (APIC_DELIVERY_FIXED    << IOAPIC_REDIR_DVL_MODE)   | \
         (APIC_MODE_PHYSICAL     << IOAPIC_REDIR_DEST_MODE)  )
 
@@ -139,9 +138,20 @@ hy_info_ioapic_t *ioapic_get_by_gsi(uint32_t gsi);
  */
 void ioapic_analyze(void);
 
+/**
+ * Routes the GSIs to the CPUs according to the IRQ policy of the kernel header
+ * and fills the GSI to CPU table. Only CPUs that can be addressed by an IO
+ * APIC (APIC id below 0xFF) are chosen.
+ *
+ * Must be called on the BSP after all APs have been booted.
+ */
+void ioapic_route(void);
+
 /**
  * Creates a redirection entry.
  *
+ * For the kernel, ioapic_route() must have been called before.
+ *
  * @param gsi the GSI number of the redirection
  * @param kernel whether to use the entry for the kernel or the loader
  * @return redirection entry
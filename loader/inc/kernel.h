@@ -39,9 +39,34 @@ extern void *kernel_binary;
 
 /**
  * Pointer to the kernel header, after it has been discovered by kernel_analyze().
+ *
+ * Points into the kernel binary's file image until kernel_load_wait() has been
+ * called, so only the magic and flags may be accessed before.
  */
 extern hy_header_root_t *kernel_header;
 
+/**
+ * Size of the kernel header in bytes, as given by the size of its symbol.
+ *
+ * Kernels that predate a field of the header provide a shorter header, so the
+ * fields past the IRQ array must be read with KERNEL_HEADER_FIELD().
+ */
+extern size_t kernel_header_size;
+
+/**
+ * Reads the <field> of the kernel header, or zero if the field lies beyond the
+ * end of the header the kernel provides.
+ */
+#define KERNEL_HEADER_FIELD(field) \
+    ((__builtin_offsetof(hy_header_root_t, field) + sizeof(kernel_header->field) <= kernel_header_size) \
+        ? kernel_header->field : 0)
+
+/**
+ * The top of the stack each CPU enters the kernel with, indexed like the CPU
+ * info table. Set up by kernel_setup_stacks().
+ */
+extern uintptr_t *kernel_stack_top;
+
 /**
  * Finds the kernel binary module or panics if there is none.
  */
@@ -54,19 +79,41 @@ void kernel_check(void);
 
 /**
  * Locates the kernel header in the kernel binary or panics if there is none.
+ *
+ * Can be called before the kernel is loaded, so the flags of the header are
+ * available early during startup.
  */
 void kernel_analyze(void);
 
 /**
- * Maps the stack of the current CPU to the virtual address specified in the
- * kernel header, if any. Also moves the stack pointer to an equivalent
- * offset in the mapped stack.
+ * Maps the kernel binary and queues copying its segments in the work pool.
+ * Must be called after kernel_analyze().
+ *
+ * The image, including the kernel header, may only be accessed after
+ * kernel_load_wait().
+ */
+void kernel_load(void);
+
+/**
+ * Waits for the kernel binary to be loaded and points kernel_header to the
+ * header in the loaded image.
+ */
+void kernel_load_wait(void);
+
+/**
+ * Allocates the stacks of all present CPUs with the size given in the kernel
+ * header, placing each on its CPU's NUMA domain, and maps them to the virtual
+ * stack address specified in the kernel header, if any.
+ *
+ * The virtual stacks are packed by the index of the CPU in the CPU table,
+ * each preceded by the number of unmapped guard pages given in the
+ * kernel header.
  */
-void kernel_map_stack(void);
+void kernel_setup_stacks(void);
 
 /**
- * Maps the info tables to the virtual address specified in the kernel header,
- * if any.
+ * Maps the final info tables (see info_place()) to the virtual address
+ * specified in the kernel header, if any.
  */
 void kernel_map_info(void);
 
@@ -81,11 +128,14 @@ void kernel_map_idt(void);
 void kernel_map_gdt(void);
 
 /**
- * Jumps to the kernel's BSP entry point
+ * Jumps to the kernel's BSP entry point, passing the address of the root info
+ * table in RDI.
  */
 void kernel_enter_bsp(void);
 
 /**
- * Jumps to the kernel's AP entry point or halts, if there is none.
+ * Jumps to the kernel's AP entry point or halts, if there is none. When the
+ * kernel header requests parking, waits in the CPU's mailbox instead until
+ * the kernel releases the AP.
  */
 void kernel_enter_ap(void);
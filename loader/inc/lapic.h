@@ -33,6 +33,7 @@
 #define LAPIC_REG_TPR           0x08    //< Task Priority Register
 #define LAPIC_REG_EOI           0x0B    //< End of Interrupt
 #define LAPIC_REG_LDR           0x0D    //< Logical Destination Register
+#define LAPIC_REG_DFR           0x0E    //< Destination Format Register (xAPIC)
 #define LAPIC_REG_SVR           0x0F    //< Spurious Vector Register
 #define LAPIC_REG_ICR_X2APIC    0x30    //< Interrupt Command Register (QWORD, x2APIC)
 #define LAPIC_REG_ICR_LOW       0x30    //< Interrupt Command Register (lower DWORD)
@@ -76,7 +77,11 @@
 #define LAPIC_LINT0             (0b111 << 8) | (1 << 15)
 #define LAPIC_LINT1             (0b100 << 8)
 #define LAPIC_ERRINT            (1 << 16)
-#define LAPIC_LDR               (1 << (lapic_id() % 8))
+#define LAPIC_LDR               ((1 << (lapic_id() % 8)) << 24)
+#define LAPIC_DFR               0xFFFFFFFF  //< flat model
+
+// Time (in micro seconds) to measure the LAPIC timer against the TSC
+#define LAPIC_CALIBRATE_TIME    1000
 
 // INIT IPI
 #define LAPIC_IPI_INIT                                 ( \
@@ -133,9 +138,20 @@ void lapic_detect(void);
 
 /**
  * Enables the CPU's LAPIC and configures it to reasonable defaults.
+ *
+ * In xAPIC mode the flat logical destination model is used; in x2APIC mode the
+ * logical ID is fixed by the hardware. Stores the logical ID and cluster of
+ * the CPU in its entry of the CPU info table.
  */
 void lapic_setup(void);
 
+/**
+ * Builds the cluster table from the logical IDs of the present CPUs.
+ *
+ * Must be called on the BSP after all APs have been booted.
+ */
+void lapic_clusters(void);
+
 /**
  * Returns the APIC id of the CPU's LAPIC.
  *
@@ -143,6 +159,14 @@ void lapic_setup(void);
  */
 uint32_t lapic_id(void);
 
+/**
+ * Returns the index of the current CPU in the CPU info table, or panics if the
+ * CPU has no entry (its LAPIC is missing or disabled in the MADT).
+ *
+ * @return index of the CPU
+ */
+size_t lapic_cpu_index(void);
+
 /**
  * Signals an EOI to the CPU's LAPIC.
  */
@@ -173,15 +197,37 @@ void lapic_ipi(uint32_t icr_low, uint32_t destination);
 void lapic_timer_update(uint32_t init_count, uint8_t vector, bool mask, bool periodic);
 
 /**
- * Calibrates the timer using the PIT and writes the results to the info tables.
+ * Calibrates the timer of the calling CPU's LAPIC against the TSC and writes
+ * the results (LAPIC timer and TSC frequency) to the info tables.
+ *
+ * Requires timer_calibrate() to have been called on the BSP. As no shared
+ * device is involved, all CPUs can calibrate their timers at the same time.
  */
 void lapic_timer_calibrate(void);
 
+/**
+ * Starts the LAPIC timer as a masked one-shot timer that expires after the
+ * specified time (in micro seconds). Use lapic_timer_expired() to poll it.
+ *
+ * The LAPIC timer must have been calibrated on the calling CPU. Times that
+ * exceed the range of the timer's counter are truncated.
+ *
+ * @param time the time until expiry in micro seconds
+ */
+void lapic_timer_start(uint64_t time);
+
+/**
+ * Checks whether the LAPIC timer started by lapic_timer_start() has expired.
+ *
+ * @return true when the timer has expired, false otherwise
+ */
+bool lapic_timer_expired(void);
+
 /**
  * Waits for the specified time (in micro seconds) using the LAPIC timer.
  *
- * Will reset the LAPIC timer and will temporarily change an IDT entry. Make sure
- * all other interrupts are masked.
+ * Polls the LAPIC timer with its interrupt masked, so no IDT entry has to be
+ * changed and interrupts can stay disabled.
  *
  * @param time the time to wait in micro seconds
  */
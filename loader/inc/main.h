@@ -61,5 +61,8 @@ void main_bsp(void);
  * When the kernel specified an AP entry point, the AP will spin on the
  * main_entry_barrier and then enter the kernel at said entry point; otherwise
  * it will halt (hlt).
+ *
+ * @param tsc_low lower half of the TSC recorded on trampoline entry
+ * @param tsc_high upper half of the TSC recorded on trampoline entry
  */
-void main_ap(void);
+void main_ap(uint32_t tsc_low, uint32_t tsc_high);
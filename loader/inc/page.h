@@ -30,7 +30,16 @@
 #define PAGE_FLAG_PRESENT   (1 << 0)		//< entry is present
 #define PAGE_FLAG_WRITABLE  (1 << 1)		//< page can be written to
 #define PAGE_FLAG_USER      (1 << 2)		//< page can be accessed from DPL=3
+#define PAGE_FLAG_LARGE     (1 << 7)		//< entry maps a large page (PS)
 #define PAGE_FLAG_GLOBAL    (1 << 8)		//< page sticks in TLB on CR3 writes
+#define PAGE_FLAG_PAT       (1 << 7)		//< PAT bit of a 4kB page
+#define PAGE_FLAG_PAT_LARGE (1 << 12)		//< PAT bit of a large page
+#define PAGE_FLAG_NX        (1ULL << 63)	//< page can not be executed
+
+// Page Sizes
+#define PAGE_SIZE_4K        0x1000
+#define PAGE_SIZE_2M        0x200000
+#define PAGE_SIZE_1G        0x40000000
 
 // Page Model Levels
 #define PAGE_LEVEL_PML4     4
@@ -41,12 +50,98 @@
 // Entry analysis
 #define PAGE_PHYSICAL(a)    (a & (0xFFFFFFFFFFFF << 12))
 #define PAGE_INDEX(a,l)     ((a >> (12 + (l - 1) * 9)) & 0x1FF)
+#define PAGE_LEVEL_SIZE(l)  (((uint64_t) PAGE_SIZE_4K) << ((l - 1) * 9))
+
+// Page Structure Pools
+#define PAGE_POOL_SIZE      0x10000		//< size of the first pool in bytes
+#define PAGE_POOL_MAX       24			//< maximum number of pools
 
 // Page structures
 extern uint64_t page_pml4[512];
 extern uint64_t page_idn_pdp[512];
 extern uint64_t page_idn_pd[512 * 64];
 
+/**
+ * A contiguous pool of frames the page structures are allocated from.
+ */
+typedef struct page_pool {
+	uintptr_t begin;				//< address of the first frame in the pool
+	uintptr_t end;					//< address after the last allocated frame
+} page_pool_t;
+
+/**
+ * Caches the page structure the last entry has been written to, so mappings
+ * of consecutive addresses do not require a walk of the page structures.
+ */
+typedef struct page_cursor {
+	uint64_t *table;				//< the cached page structure
+	uintptr_t base;					//< the first virtual address covered by it
+	uint8_t level;					//< the level of the cached page structure
+} page_cursor_t;
+
+/**
+ * Number of pages that have been mapped so far.
+ */
+extern size_t page_mapped_count;
+
+/**
+ * Number of TSC ticks that have been spent mapping pages so far.
+ */
+extern uint64_t page_map_cycles;
+
+/**
+ * The pools page structures have been allocated from.
+ */
+extern page_pool_t page_pools[PAGE_POOL_MAX];
+
+/**
+ * Number of pools in page_pools.
+ */
+extern size_t page_pool_count;
+
+/**
+ * Whether the CPU supports 1 GiB pages.
+ */
+extern bool page_1g_supported;
+
+/**
+ * Number of GiB the identity map should cover, as determined from the
+ * multiboot memory map by boot32_map.
+ */
+extern uint32_t page_identity_target;
+
+/**
+ * Number of GiB that are currently covered by the identity map.
+ */
+extern uint32_t page_identity_mapped;
+
+/**
+ * Determines the paging features to enable on all CPUs, as requested by the
+ * kernel header and supported by the CPU, and reports them in the root info
+ * table's flags.
+ *
+ * Must be called on the BSP after the kernel header has been found.
+ */
+void page_detect(void);
+
+/**
+ * Enables the paging features determined by page_detect on the current CPU.
+ */
+void page_setup(void);
+
+/**
+ * Extends the identity map to the size given by page_identity_target, if the
+ * boot code could not map all of it using its static page structures.
+ *
+ * Requires the heap to be set up.
+ */
+void page_identity_extend(void);
+
+/**
+ * Detects the paging features supported by the CPU.
+ */
+void page_init(void);
+
 /**
  * Maps the page at the given virtual address to the given physical one and
  * sets the provided flags.
@@ -61,6 +156,36 @@ extern uint64_t page_idn_pd[512 * 64];
  */
 void page_map(uintptr_t physical, uintptr_t virtual, uint64_t flags);
 
+/**
+ * Maps <length> bytes at the given virtual address to the given physical
+ * address and sets the provided flags.
+ *
+ * Uses 1 GiB or 2 MiB pages wherever the alignment of both addresses and the
+ * remaining length allow it, and 4 KiB pages at the unaligned edges. Large
+ * pages that are only partially remapped are split, keeping their NX and PAT
+ * bits. Ranges already covered by page structures are mapped into them, with
+ * smaller pages, instead of replacing them by a large page.
+ *
+ * The page structures are only walked when the range crosses into another
+ * structure, and TLB entries are only invalidated for pages that have been
+ * mapped before.
+ *
+ * The physical and virtual address are aligned down to the lower page boundary
+ * and the length is aligned up to the upper page boundary.
+ *
+ * @param physical the physical address of the first frame to map to
+ * @param virtual the virtual address of the first page to map
+ * @param length the length of the range to map in bytes
+ * @param flags the flags to map with
+ */
+void page_map_range(uintptr_t physical, uintptr_t virtual, size_t length, uint64_t flags);
+
+/**
+ * Marks the frames used for page structures in the memory map, using the
+ * HY_INFO_MMAP_FLAG_PAGING flag.
+ */
+void page_pool_export(void);
+
 /**
  * Invalidates a page in the CPU's TLB.
  *
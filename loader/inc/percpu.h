@@ -0,0 +1,59 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// MSRs
+#define PERCPU_MSR_FS_BASE      0xC0000100
+#define PERCPU_MSR_GS_BASE      0xC0000101
+
+/**
+ * The value of the GS base (and optionally the FS base) of each CPU, indexed
+ * like the CPU info table. Zero for CPUs without a per-CPU area.
+ */
+extern uintptr_t *percpu_base;
+
+/**
+ * Allocates the per-CPU areas of all present CPUs as described by the kernel
+ * header, fills them with the template and maps them to the virtual address
+ * specified in the kernel header, if any.
+ *
+ * The areas are placed on the NUMA domain of the CPU they belong to. When the
+ * area is taken from the kernel's PT_TLS segment, the base points to the end
+ * of the TLS block (a pointer to itself is stored there), as required by the
+ * AMD64 TLS ABI; otherwise it points to the beginning of the area.
+ *
+ * Also determines whether to enable the RD/WR FS/GS BASE instructions.
+ * Must be called on the BSP after kernel_setup_stacks().
+ */
+void percpu_setup_areas(void);
+
+/**
+ * Loads the base of the current CPU's per-CPU area into the GS base (and the
+ * FS base, if requested) and enables the RD/WR FS/GS BASE instructions, if
+ * determined by percpu_setup_areas().
+ */
+void percpu_setup(void);
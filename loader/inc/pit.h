@@ -27,27 +27,31 @@
 #include <stdint.h>
 
 // PIT constants
-#define PIT_IO_COUNTER      0x40        //< port to access the counter
+#define PIT_IO_CHANNEL2     0x42        //< port to access the counter of channel 2
 #define PIT_IO_INIT         0x43        //< port to initialize the PIT
-#define PIT_IRQ             0x0         //< PIT IRQ number (in non PCAT_COMPAT mode)
-#define PIT_IRQ_PCAT_COMPAT 0x2         //< PIT IRQ number (in PCAT_COMPAT mode)
-#define PIT_FREQ_BASE       1193180     //< frequency of the PIT's oscillator in Hz
-#define PIT_VECTOR          0x30        //< interrupt vector used by loader
+#define PIT_IO_GATE         0x61        //< port to control the gate of channel 2
+#define PIT_FREQ_BASE       1193182     //< frequency of the PIT's oscillator in Hz
 
-/**
- * Sets a new PIT frequency (in Hz).
- *
- * @param freq the new frequency in Hz
- */
-void pit_freq_set(uint16_t freq);
+// Bits in the channel 2 gate port
+#define PIT_GATE_ENABLE     (1 << 0)    //< gate input of channel 2
+#define PIT_GATE_SPEAKER    (1 << 1)    //< connects channel 2 to the speaker
+#define PIT_GATE_OUT        (1 << 5)    //< output of channel 2
+
+// Command: Channel 2, lobyte/hibyte access, mode 0 (interrupt on terminal count)
+#define PIT_CMD_ONESHOT     0xB0
 
 /**
- * Routes the PIT interrupt to the default vector (PIT_VECTOR) on the
- * calling processor using the IO APIC.
+ * Starts channel 2 of the PIT as a one-shot counter that counts down from
+ * <count>. The speaker stays disconnected and no interrupt is raised; use
+ * pit_oneshot_done() to poll for the terminal count.
+ *
+ * @param count the number of PIT ticks until the terminal count
  */
-void pit_route(void);
+void pit_oneshot_start(uint16_t count);
 
 /**
- * Masks the PIT interrupt in the IO APIC again.
+ * Checks whether channel 2 of the PIT has reached its terminal count.
+ *
+ * @return true when the terminal count has been reached, false otherwise
  */
-void pit_mask(void);
+bool pit_oneshot_done(void);
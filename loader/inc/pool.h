@@ -0,0 +1,91 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * Maximum number of jobs that can be queued at once.
+ */
+#define POOL_JOB_MAX            1024
+
+/**
+ * Size of the chunks bulk operations are split into, in bytes.
+ */
+#define POOL_CHUNK_SIZE         0x40000
+
+// Job types
+#define POOL_JOB_COPY           1       //< copy length bytes from source to target
+#define POOL_JOB_ZERO           2       //< zero length bytes at target
+
+/**
+ * A job in the work queue.
+ */
+typedef struct pool_job {
+    uintptr_t target;           //< address to write to
+    uintptr_t source;           //< address to copy from (POOL_JOB_COPY)
+    size_t length;              //< number of bytes
+    uint8_t type;               //< job type (POOL_JOB_*)
+} pool_job_t;
+
+/**
+ * Queues a copy of <length> bytes from <source> to <target>, split into
+ * chunks of POOL_CHUNK_SIZE. The regions must not overlap.
+ *
+ * Must only be called on the BSP. The copy is complete after pool_wait().
+ *
+ * @param target the address to copy to
+ * @param source the address to copy from
+ * @param length the number of bytes to copy
+ */
+void pool_copy(void *target, void *source, size_t length);
+
+/**
+ * Queues zeroing <length> bytes at <target>, split into chunks of
+ * POOL_CHUNK_SIZE.
+ *
+ * Must only be called on the BSP. The memory is zeroed after pool_wait().
+ *
+ * @param target the address of the memory to zero
+ * @param length the number of bytes to zero
+ */
+void pool_zero(void *target, size_t length);
+
+/**
+ * Takes a single job from the queue and executes it on the calling CPU,
+ * recording it in the CPU's entry of the work statistics table.
+ *
+ * Can be called concurrently by all CPUs.
+ *
+ * @return whether a job has been executed
+ */
+bool pool_work(void);
+
+/**
+ * Helps executing the queued jobs until all of them are complete.
+ *
+ * Must only be called on the BSP.
+ */
+void pool_wait(void);
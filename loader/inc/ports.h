@@ -41,3 +41,11 @@ void outb(uint16_t port, uint8_t value);
  * @return the byte read from the port
  */
 uint8_t inb(uint16_t port);
+
+/**
+ * Reads a double word from an input <port>.
+ *
+ * @param port the port to read from
+ * @return the double word read from the port
+ */
+uint32_t inl(uint16_t port);
@@ -0,0 +1,55 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// XCR0 state components
+#define SIMD_XCR0_X87           (1 << 0)        //< x87 FPU state
+#define SIMD_XCR0_SSE           (1 << 1)        //< SSE (XMM) state
+#define SIMD_XCR0_AVX           (1 << 2)        //< AVX (upper YMM) state
+#define SIMD_XCR0_BND           (3 << 3)        //< MPX bound registers and config
+#define SIMD_XCR0_AVX512        (7 << 5)        //< AVX-512 opmask and upper ZMM state
+#define SIMD_XCR0_AMX           (3ull << 17)    //< AMX tile config and data
+
+/**
+ * Size of the FXSAVE area in bytes.
+ */
+#define SIMD_FXSAVE_SIZE        512
+
+/**
+ * Determines whether to enable SSE and XSAVE, as requested by the kernel
+ * header, and which state components to enable in XCR0, based on the features
+ * that are common to all CPUs. Reports the result in the info root and
+ * enables them on the BSP.
+ *
+ * Must be called on the BSP after features_merge().
+ */
+void simd_detect(void);
+
+/**
+ * Enables SSE and XSAVE on the current CPU, if determined by simd_detect().
+ */
+void simd_setup(void);
@@ -32,14 +32,99 @@
 #define SMP_BOOT16_TARGET 0x1000
 
 /**
- * The number of started APs. Used by smp_boot_all() to determine, when the initialization
- * of an AP is complete.
+ * The size of the stack each AP runs the loader on.
+ */
+#define SMP_STACK_SIZE 0x1000
+
+/**
+ * Time (in micro seconds) the BSP waits for the APs to check in after the
+ * STARTUP IPIs have been sent. APs that do not respond in time are regarded
+ * as not present.
+ */
+#define SMP_TIMEOUT (100 * 1000)
+
+/**
+ * Time (in micro seconds) between the INIT and the first STARTUP IPI.
+ */
+#define SMP_INIT_DELAY (10 * 1000)
+
+// States of the APs during startup.
+#define SMP_STATE_NONE          0       //< not an AP that is being booted
+#define SMP_STATE_BOOTING       1       //< IPIs sent, not checked in yet
+#define SMP_STATE_ALIVE         2       //< checked in, performing setup
+#define SMP_STATE_DEAD          3       //< did not check in in time
+
+/**
+ * The number of APs that have completed their setup.
  */
 extern volatile uint64_t smp_ready_count;
 
 /**
- * Boots all application processors (APs) that have an entry in the info tables.
+ * The number of APs that have checked in after being started.
+ */
+extern volatile uint64_t smp_alive_count;
+
+/**
+ * Physical address of the next free AP stack. Each AP atomically takes one
+ * stack of SMP_STACK_SIZE bytes when it enters boot32_ap.
+ */
+extern volatile uint32_t smp_stack_next;
+
+/**
+ * The startup state of each CPU (SMP_STATE_*), indexed like the CPU info table.
+ */
+extern volatile uint8_t *smp_state;
+
+/**
+ * Set by the BSP when the APs may continue with the part of their setup that
+ * depends on the loaded kernel (paging features, per-CPU areas, syscalls).
+ */
+extern volatile uint8_t smp_released;
+
+/**
+ * Starts booting all application processors (APs) that have an entry in the
+ * info tables by sending the INIT IPIs, and returns immediately, so the BSP
+ * can continue while the APs settle.
+ *
+ * Requires the LAPIC timer of the BSP to be calibrated.
+ */
+void smp_init(void);
+
+/**
+ * Sends the STARTUP IPIs to the APs, after waiting for the remainder of
+ * SMP_INIT_DELAY since smp_init(), and returns once they have been sent. The
+ * APs then enter long mode, calibrate their timers and decode their topology
+ * concurrently to the BSP.
+ *
+ * The BSP executes jobs from the work pool while it waits.
+ */
+void smp_startup(void);
+
+/**
+ * Waits for the APs to check in, marks the APs that did not check in within
+ * SMP_TIMEOUT after smp_startup() as not present in the info tables, releases
+ * the remaining ones into the second part of their setup and returns when
+ * all of them have completed it.
  *
- * Will return, when all APs are successfully started.
+ * Must be called once the state the second part depends on is ready.
+ */
+void smp_join(void);
+
+/**
+ * Waits until the BSP releases the calling AP in smp_join(), executing jobs
+ * from the work pool in the meantime.
+ */
+void smp_wait_release(void);
+
+/**
+ * Reports that the calling AP is alive. Must be called by each AP as early as
+ * possible after entering long mode.
+ *
+ * Halts the AP, when the BSP has already given up on it.
+ */
+void smp_checkin(void);
+
+/**
+ * Reports that the calling AP has completed its setup.
  */
-void smp_setup(void);
+void smp_ready(void);
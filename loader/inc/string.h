@@ -26,6 +26,38 @@
 #pragma once
 #include <stdint.h>
 
+// Memory Primitive Methods
+#define STRING_METHOD_GENERIC   0       //< rep movsq/stosq followed by a byte tail
+#define STRING_METHOD_ERMS      1       //< rep movsb/stosb (ERMS or FSRM)
+
+/**
+ * Copies of at least this many bytes use non-temporal stores, so they do not
+ * evict the caches for data that will not be read by Hydrogen again.
+ */
+#define STRING_NT_THRESHOLD     (4 << 20)
+
+/**
+ * Number of bytes that have been copied using memcpy so far.
+ */
+extern volatile size_t memcpy_bytes;
+
+/**
+ * Number of TSC ticks that have been spent in memcpy so far.
+ */
+extern volatile uint64_t memcpy_cycles;
+
+/**
+ * The method used by memcpy and memset (STRING_METHOD_*).
+ */
+extern uint8_t string_method;
+
+/**
+ * Selects the memory primitives that suit the features of the CPU best.
+ *
+ * Until called, memcpy and memset use the generic method.
+ */
+void string_init(void);
+
 size_t strlen(const int8_t *str);
 uint8_t strcmp(const int8_t *a, const int8_t *b);
 int8_t *strcpy(int8_t *dest, const int8_t *src);
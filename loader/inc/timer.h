@@ -0,0 +1,73 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// Reference sources the TSC can be calibrated against.
+#define TIMER_SOURCE_NONE       0       //< not calibrated yet
+#define TIMER_SOURCE_CPUID      1       //< crystal clock reported by CPUID 0x15/0x16
+#define TIMER_SOURCE_HPET       2       //< main counter of the HPET
+#define TIMER_SOURCE_PM         3       //< ACPI power management timer
+#define TIMER_SOURCE_PIT        4       //< channel 2 of the PIT (polled)
+
+// Time (in micro seconds) to measure the TSC against each source
+#define TIMER_WINDOW_HPET       1000
+#define TIMER_WINDOW_PM         2000
+#define TIMER_WINDOW_PIT        10000
+
+// HPET registers (byte offsets in the MMIO region)
+#define TIMER_HPET_REG_CAPS     0x00    //< capabilities and counter period
+#define TIMER_HPET_REG_CONFIG   0x10    //< general configuration
+#define TIMER_HPET_REG_COUNTER  0xF0    //< main counter
+
+// HPET capability bits
+#define TIMER_HPET_CAPS_COUNT_64 (1 << 13) //< main counter is 64 bits wide
+
+// HPET general configuration bits
+#define TIMER_HPET_CONFIG_EN    (1 << 0)
+
+/**
+ * Frequency of the TSC in Hz. Valid after timer_calibrate() has been called.
+ *
+ * Hydrogen assumes that the TSCs of all CPUs tick at the same constant rate.
+ */
+extern uint64_t timer_tsc_freq;
+
+/**
+ * The source the TSC frequency has been determined with (TIMER_SOURCE_*).
+ */
+extern uint8_t timer_source;
+
+/**
+ * Determines the frequency of the TSC on the BSP.
+ *
+ * Uses the fastest source that is available and accurate: The crystal clock
+ * frequency reported by CPUID, then the HPET, the ACPI PM timer and finally
+ * channel 2 of the PIT. None of the sources requires interrupts.
+ *
+ * The ACPI tables must have been parsed before.
+ */
+void timer_calibrate(void);
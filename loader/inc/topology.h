@@ -0,0 +1,89 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+#include <stdint.h>
+
+// CPUID leaves
+#define TOPOLOGY_LEAF_CACHE         0x04    //< deterministic cache parameters
+#define TOPOLOGY_LEAF_FEATURES      0x07    //< structured extended features
+#define TOPOLOGY_LEAF_X2APIC        0x0B    //< extended topology enumeration
+#define TOPOLOGY_LEAF_HYBRID        0x1A    //< hybrid information
+#define TOPOLOGY_LEAF_V2            0x1F    //< V2 extended topology enumeration
+#define TOPOLOGY_LEAF_EXT_FEATURES  0x80000001
+#define TOPOLOGY_LEAF_EXT_SIZE      0x80000008
+#define TOPOLOGY_LEAF_EXT_CACHE     0x8000001D
+#define TOPOLOGY_LEAF_EXT_TOPOLOGY  0x8000001E
+
+// Level types of the extended topology leaves
+#define TOPOLOGY_LEVEL_INVALID      0
+#define TOPOLOGY_LEVEL_SMT          1
+#define TOPOLOGY_LEVEL_CORE         2
+#define TOPOLOGY_LEVEL_DIE          5
+
+/**
+ * Maximum number of caches recorded per CPU.
+ */
+#define TOPOLOGY_CACHE_MAX          8
+
+/**
+ * A cache of a CPU, as reported by the deterministic cache parameters.
+ */
+typedef struct topology_cache {
+    uint8_t level;              //< cache level (zero terminates the list)
+    uint8_t type;               //< cache type (HY_INFO_CACHE_TYPE_*)
+    uint16_t flags;             //< cache flags (HY_INFO_CACHE_FLAG_*)
+    uint32_t line_size;         //< line size in bytes
+    uint32_t ways;              //< ways of associativity
+    uint32_t sets;              //< number of sets
+    uint32_t share_shift;       //< number of APIC id bits of the sharing CPUs
+} topology_cache_t;
+
+/**
+ * Allocates the space in which each CPU records its caches.
+ *
+ * Must be called on the BSP after the CPU table has been built.
+ */
+void topology_init(void);
+
+/**
+ * Decodes the topology of the current CPU from CPUID (leaf 0x1F or 0x0B, with
+ * a fallback to the legacy leaves 0x01, 0x04 and 0x80000008) and stores the
+ * package, die, core and SMT ids as well as the hybrid core type (leaf 0x1A)
+ * in the CPU's info table entry. Also records the CPU's caches from CPUID
+ * leaf 4 (or 0x8000001D).
+ *
+ * Must be called on every CPU after the CPU table has been built.
+ */
+void topology_detect(void);
+
+/**
+ * Assigns dense core and package indices to all present CPUs and stores the
+ * number of cores and packages in the info root. Builds the cache table from
+ * the caches recorded by the CPUs and links each CPU to its caches.
+ *
+ * Must be called on the BSP after all APs have been booted.
+ */
+void topology_index(void);
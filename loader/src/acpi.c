@@ -24,7 +24,6 @@
  */
 
 #include <acpi.h>
-#include <heap.h>
 #include <hydrogen.h>
 #include <info.h>
 #include <screen.h>
@@ -33,25 +32,27 @@
 
 acpi_madt_t *acpi_madt = 0;
 acpi_srat_t *acpi_srat = 0;
+acpi_slit_t *acpi_slit = 0;
+acpi_hmat_t *acpi_hmat = 0;
+acpi_fadt_t *acpi_fadt = 0;
+acpi_hpet_t *acpi_hpet = 0;
 
 static void acpi_add_cpu(uint32_t apic_id, uint32_t acpi_id, uint32_t flags)
 {
-    hy_info_cpu_t *cpu = &info_cpu[apic_id];
+    if (0 == (flags & ACPI_MADT_LAPIC_ENABLED))
+        return;
+
+    hy_info_cpu_t *cpu = info_cpu_add(apic_id);
+
+    // Already listed by another LAPIC entry
+    if (0 == cpu)
+        return;
 
     cpu->acpi_id = acpi_id;
-    cpu->apic_id = apic_id;
-    cpu->flags |= 0;
+    cpu->flags = HY_INFO_CPU_FLAG_PRESENT;
     cpu->domain = 0;
 
-    if (0 != (flags & ACPI_MADT_LAPIC_ENABLED)) {
-        cpu->flags |= HY_INFO_CPU_FLAG_PRESENT;
-        ++info_root->cpu_count_active;
-    }
-
-    size_t new_count = apic_id + 1;
-    if (info_root->cpu_count < new_count) {
-        info_root->cpu_count = new_count;
-    }
+    ++info_root->cpu_count_active;
 }
 
 static void acpi_parse_madt_x2lapic(acpi_madt_x2lapic_t *entry)
@@ -93,6 +94,48 @@ static void acpi_parse_madt_iso(acpi_madt_iso_t *iso)
     }
 }
 
+/**
+ * Allocates the CPU and IO APIC tables for the entries in the MADT, that is
+ * one CPU entry for each enabled LAPIC and one entry for each IO APIC.
+ *
+ * @param madt the MADT
+ */
+static void acpi_madt_alloc(acpi_madt_t *madt)
+{
+    acpi_madt_entry_t *entry = (acpi_madt_entry_t *) ((uintptr_t) madt + sizeof (acpi_madt_t));
+    size_t size_left = madt->header.length - sizeof (acpi_madt_t);
+    size_t cpu_count = 0;
+    size_t ioapic_count = 0;
+
+    while (size_left > 0) {
+        uint32_t flags = 0;
+
+        switch (entry->type) {
+        case ACPI_MADT_TYPE_LAPIC:
+            flags = ((acpi_madt_lapic_t *) entry)->flags;
+            break;
+
+        case ACPI_MADT_TYPE_X2LAPIC:
+            flags = ((acpi_madt_x2lapic_t *) entry)->flags;
+            break;
+
+        case ACPI_MADT_TYPE_IOAPIC:
+            ++ioapic_count;
+            break;
+        }
+
+        if (0 != (flags & ACPI_MADT_LAPIC_ENABLED)) {
+            ++cpu_count;
+        }
+
+        size_left -= entry->length;
+        entry = (acpi_madt_entry_t *) ((uintptr_t) entry + entry->length);
+    }
+
+    info_cpu_alloc(cpu_count);
+    info_ioapic_alloc(ioapic_count);
+}
+
 static void acpi_parse_madt(acpi_madt_t *madt)
 {
     info_root->lapic_paddr = madt->lapic_paddr;
@@ -104,8 +147,7 @@ static void acpi_parse_madt(acpi_madt_t *madt)
     acpi_madt_entry_t *entry = (acpi_madt_entry_t *) ((uintptr_t) madt + sizeof (acpi_madt_t));
     size_t size_left = madt->header.length - sizeof (acpi_madt_t);
 
-    info_root->cpu_offset = heap_top - (uintptr_t) info_root;
-    info_cpu = (hy_info_cpu_t *) heap_top;
+    acpi_madt_alloc(madt);
 
     while (size_left > 0) {
         size_left -= entry->length;
@@ -130,11 +172,18 @@ static void acpi_parse_madt(acpi_madt_t *madt)
 
         entry = (acpi_madt_entry_t *) ((uintptr_t) entry + entry->length);
     }
+}
 
-    size_t cpu_length = sizeof(hy_info_cpu_t) * info_root->cpu_count;
-    cpu_length = (cpu_length + 0xFFF) & ~0xFFF;
-    heap_top += cpu_length;
-    info_root->length += cpu_length;
+/**
+ * Extends the number of NUMA domains to include the given <domain>.
+ *
+ * @param domain the id of the domain
+ */
+static void acpi_add_domain(uint64_t domain)
+{
+    if (domain < 0xFFFF && domain + 1 > info_root->numa_domain_count) {
+        info_root->numa_domain_count = domain + 1;
+    }
 }
 
 static void acpi_parse_srat_lapic(acpi_srat_lapic_t *entry)
@@ -147,7 +196,12 @@ static void acpi_parse_srat_lapic(acpi_srat_lapic_t *entry)
     domain |= entry->domain_high[1] << 16;
     domain |= entry->domain_high[2] << 24;
 
-    info_cpu[entry->apic_id].domain = domain;
+    size_t index = info_cpu_find(entry->apic_id);
+
+    if (INFO_CPU_NONE != index)
+        info_cpu[index].domain = domain;
+
+    acpi_add_domain(domain);
 }
 
 static void acpi_parse_srat_x2lapic(acpi_srat_x2lapic_t *entry)
@@ -155,38 +209,224 @@ static void acpi_parse_srat_x2lapic(acpi_srat_x2lapic_t *entry)
     if (0 == (entry->flags & ACPI_SRAT_LAPIC_ENABLED))
         return;
 
-    info_cpu[entry->x2apic_id].domain = entry->domain;
+    size_t index = info_cpu_find(entry->x2apic_id);
+
+    if (INFO_CPU_NONE != index)
+        info_cpu[index].domain = entry->domain;
+
+    acpi_add_domain(entry->domain);
+}
+
+static void acpi_parse_srat_memory(acpi_srat_memory_t *entry)
+{
+    if (0 == (entry->flags & ACPI_SRAT_MEMORY_ENABLED))
+        return;
+
+    hy_info_numa_mem_t *mem = &info_numa_mem[info_root->numa_mem_count++];
+    mem->address = ((uint64_t) entry->base_high << 32) | entry->base_low;
+    mem->length = ((uint64_t) entry->length_high << 32) | entry->length_low;
+    mem->domain = entry->domain;
+    acpi_add_domain(entry->domain);
+
+    if (0 != (entry->flags & ACPI_SRAT_MEMORY_HOTPLUG))
+        mem->flags |= HY_INFO_NUMA_MEM_FLAG_HOTPLUG;
+
+    if (0 != (entry->flags & ACPI_SRAT_MEMORY_NONVOLATILE))
+        mem->flags |= HY_INFO_NUMA_MEM_FLAG_NONVOLATILE;
+}
+
+/**
+ * Checks whether the given SRAT <entry> can be parsed, given the number of
+ * bytes remaining in the table.
+ *
+ * @param entry the entry to check
+ * @param length_remaining the number of bytes remaining, beginning with the entry
+ * @return whether the entry lies within the table
+ */
+static bool acpi_srat_entry_valid(acpi_srat_entry_t *entry, size_t length_remaining)
+{
+    return length_remaining >= sizeof(acpi_srat_entry_t) &&
+            0 != entry->length && entry->length <= length_remaining;
+}
+
+/**
+ * Allocates the NUMA memory table for the enabled memory entries in the SRAT.
+ *
+ * @param srat the SRAT
+ */
+static void acpi_srat_alloc_numa_mem(acpi_srat_t *srat)
+{
+    acpi_srat_entry_t *entry = (acpi_srat_entry_t *) ((uintptr_t) srat + sizeof(acpi_srat_t));
+    size_t length_remaining = srat->header.length - sizeof(acpi_srat_t);
+    size_t count = 0;
+
+    while (acpi_srat_entry_valid(entry, length_remaining)) {
+        if (ACPI_SRAT_TYPE_MEMORY == entry->type &&
+                0 != (((acpi_srat_memory_t *) entry)->flags & ACPI_SRAT_MEMORY_ENABLED)) {
+            ++count;
+        }
+
+        length_remaining -= entry->length;
+        entry = (acpi_srat_entry_t *) ((uintptr_t) entry + entry->length);
+    }
+
+    info_numa_mem = (hy_info_numa_mem_t *) info_alloc(sizeof(hy_info_numa_mem_t) * count);
 }
 
 static void acpi_parse_srat(acpi_srat_t *srat)
 {
+    acpi_srat_alloc_numa_mem(srat);
+
     acpi_srat_entry_t *entry = (acpi_srat_entry_t *) ((uintptr_t) srat + sizeof(acpi_srat_t));
     size_t length_remaining = srat->header.length - sizeof(acpi_srat_t);
 
-    while (length_remaining > 0) {
+    while (acpi_srat_entry_valid(entry, length_remaining)) {
         switch (entry->type) {
         case ACPI_SRAT_TYPE_LAPIC:
             acpi_parse_srat_lapic((acpi_srat_lapic_t *) entry);
-
-            length_remaining -= sizeof(acpi_srat_lapic_t);
-            entry = (acpi_srat_entry_t *)((char *)entry + sizeof(acpi_srat_lapic_t));
-
             break;
 
         case ACPI_SRAT_TYPE_MEMORY:
-            // No clue what to do with this.
-
-            length_remaining -= sizeof(acpi_srat_memory_t);
-            entry = (acpi_srat_entry_t *)((char *)entry + sizeof(acpi_srat_memory_t));
+            acpi_parse_srat_memory((acpi_srat_memory_t *) entry);
             break;
 
         case ACPI_SRAT_TYPE_X2LAPIC:
             acpi_parse_srat_x2lapic((acpi_srat_x2lapic_t *) entry);
-
-            length_remaining -= sizeof(acpi_srat_x2lapic_t);
-            entry = (acpi_srat_entry_t *)((char *)entry + sizeof(acpi_srat_x2lapic_t));
             break;
         }
+
+        length_remaining -= entry->length;
+        entry = (acpi_srat_entry_t *) ((uintptr_t) entry + entry->length);
+    }
+}
+
+static void acpi_parse_slit(acpi_slit_t *slit)
+{
+    size_t domains = info_root->numa_domain_count;
+    uint64_t count = slit->locality_count;
+    uint8_t *distance = (uint8_t *) ((uintptr_t) slit + sizeof(acpi_slit_t));
+
+    if (0 == count || count > INFO_NUMA_DOMAIN_MAX || slit->header.length < sizeof(acpi_slit_t) + count * count)
+        return;
+
+    info_numa_distance = (uint8_t *) info_alloc(domains * domains);
+
+    size_t from, to;
+    for (from = 0; from < count; ++from) {
+        for (to = 0; to < count; ++to) {
+            info_numa_distance[from * domains + to] = distance[from * count + to];
+        }
+    }
+}
+
+/**
+ * Converts a HMAT latency or bandwidth <entry> to the representation in the
+ * NUMA performance table, given the structure's base unit.
+ *
+ * @param entry the entry
+ * @param base_unit the base unit of the entry
+ * @return the value to store in the NUMA performance table
+ */
+static uint32_t acpi_hmat_value(uint16_t entry, uint64_t base_unit)
+{
+    if (0xFFFF == entry)
+        return HY_INFO_NUMA_PERF_UNREACHABLE;
+
+    uint64_t value = entry * base_unit;
+
+    if (0 != base_unit && value / base_unit != entry)
+        return HY_INFO_NUMA_PERF_UNREACHABLE - 1;
+
+    if (value >= HY_INFO_NUMA_PERF_UNREACHABLE)
+        return HY_INFO_NUMA_PERF_UNREACHABLE - 1;
+
+    return value;
+}
+
+static void acpi_parse_hmat_locality(acpi_hmat_locality_t *locality)
+{
+    if (ACPI_HMAT_HIERARCHY_MEMORY != (locality->flags & ACPI_HMAT_HIERARCHY_MASK))
+        return;
+
+    uint64_t initiator_count = locality->initiator_count;
+    uint64_t target_count = locality->target_count;
+    uint64_t length = sizeof(acpi_hmat_locality_t) +
+            (initiator_count + target_count) * sizeof(uint32_t) +
+            initiator_count * target_count * sizeof(uint16_t);
+
+    if (locality->header.length < length)
+        return;
+
+    uint32_t *initiators = (uint32_t *) ((uintptr_t) locality + sizeof(acpi_hmat_locality_t));
+    uint32_t *targets = &initiators[initiator_count];
+    uint16_t *entries = (uint16_t *) &targets[target_count];
+    size_t domains = info_root->numa_domain_count;
+
+    size_t i, t;
+    for (i = 0; i < initiator_count; ++i) {
+        if (initiators[i] >= domains)
+            continue;
+
+        for (t = 0; t < target_count; ++t) {
+            if (targets[t] >= domains)
+                continue;
+
+            uint16_t entry = entries[i * target_count + t];
+
+            if (0 == entry)
+                continue;
+
+            hy_info_numa_perf_t *perf = &info_numa_perf[initiators[i] * domains + targets[t]];
+            uint32_t value = acpi_hmat_value(entry, locality->base_unit);
+
+            switch (locality->data_type) {
+            case ACPI_HMAT_DATA_ACCESS_LATENCY:
+                perf->read_latency = value;
+                perf->write_latency = value;
+                break;
+
+            case ACPI_HMAT_DATA_READ_LATENCY:
+                perf->read_latency = value;
+                break;
+
+            case ACPI_HMAT_DATA_WRITE_LATENCY:
+                perf->write_latency = value;
+                break;
+
+            case ACPI_HMAT_DATA_ACCESS_BANDWIDTH:
+                perf->read_bandwidth = value;
+                perf->write_bandwidth = value;
+                break;
+
+            case ACPI_HMAT_DATA_READ_BANDWIDTH:
+                perf->read_bandwidth = value;
+                break;
+
+            case ACPI_HMAT_DATA_WRITE_BANDWIDTH:
+                perf->write_bandwidth = value;
+                break;
+            }
+        }
+    }
+}
+
+static void acpi_parse_hmat(acpi_hmat_t *hmat)
+{
+    size_t domains = info_root->numa_domain_count;
+
+    info_numa_perf = (hy_info_numa_perf_t *) info_alloc(sizeof(hy_info_numa_perf_t) * domains * domains);
+
+    acpi_hmat_entry_t *entry = (acpi_hmat_entry_t *) ((uintptr_t) hmat + sizeof(acpi_hmat_t));
+    size_t length_remaining = hmat->header.length - sizeof(acpi_hmat_t);
+
+    while (length_remaining >= sizeof(acpi_hmat_entry_t) &&
+            entry->length >= sizeof(acpi_hmat_entry_t) && entry->length <= length_remaining) {
+        if (ACPI_HMAT_TYPE_LOCALITY == entry->type && entry->length >= sizeof(acpi_hmat_locality_t)) {
+            acpi_parse_hmat_locality((acpi_hmat_locality_t *) entry);
+        }
+
+        length_remaining -= entry->length;
+        entry = (acpi_hmat_entry_t *) ((uintptr_t) entry + entry->length);
     }
 }
 
@@ -201,6 +441,14 @@ static void acpi_parse_table(acpi_sdt_header_t *table)
         acpi_madt = (acpi_madt_t *) table;
     } else if (memcmp(&table->signature, "SRAT", 4)) {
         acpi_srat = (acpi_srat_t *) table;
+    } else if (memcmp(&table->signature, "SLIT", 4)) {
+        acpi_slit = (acpi_slit_t *) table;
+    } else if (memcmp(&table->signature, "HMAT", 4)) {
+        acpi_hmat = (acpi_hmat_t *) table;
+    } else if (memcmp(&table->signature, "FACP", 4)) {
+        acpi_fadt = (acpi_fadt_t *) table;
+    } else if (memcmp(&table->signature, "HPET", 4)) {
+        acpi_hpet = (acpi_hpet_t *) table;
     }
 }
 
@@ -262,6 +510,23 @@ void acpi_parse(void)
 
     if (0 != acpi_srat) {
         acpi_parse_srat(acpi_srat);
+        info_mmap_domains();
+    }
+
+    // The matrices are indexed by domain, so they are only exported for the
+    // domains that can be described by a reasonably sized table
+    if (0 != acpi_slit && acpi_slit->locality_count <= INFO_NUMA_DOMAIN_MAX) {
+        acpi_add_domain(acpi_slit->locality_count - 1);
+    }
+
+    if (0 != info_root->numa_domain_count && info_root->numa_domain_count <= INFO_NUMA_DOMAIN_MAX) {
+        if (0 != acpi_slit) {
+            acpi_parse_slit(acpi_slit);
+        }
+
+        if (0 != acpi_hmat && 0 != acpi_srat) {
+            acpi_parse_hmat(acpi_hmat);
+        }
     }
 
     if (0 == info_root->cpu_count) {
@@ -40,6 +40,9 @@ boot16:
 
 .cs_cleared:
     cli                                                 ; Clear interrupts
+    rdtsc                                               ; Record trampoline entry time
+    mov edi, eax                                        ; in EDI:ESI for main_ap
+    mov esi, edx
     in al, 0x92                                         ; Activate A20
     or al, 2
     out 0x92, al
@@ -26,7 +26,7 @@ bits 32
 
 global boot32_bsp
 global boot32_ap
-extern heap_top
+extern smp_stack_next
 extern multiboot_info
 extern main_bsp
 extern main_ap
@@ -35,6 +35,12 @@ extern gdt_pointer
 extern page_pml4
 extern page_idn_pdp
 extern page_idn_pd
+extern page_identity_target
+extern page_identity_mapped
+
+; Number of GiB that can be mapped using 1 GiB pages, given the space of the
+; identity PDP and the 64 identity PDs.
+%define BOOT32_IDN_1G_MAX (512 * 65)
 
 ; Protected mode entry point for the BSP.
 ;
@@ -62,12 +68,14 @@ boot32_bsp:
 
 ; Protected mode entry point for the APs.
 ;
-; Entered by the real mode bootstrap code.
+; Entered by the real mode bootstrap code; the TSC at trampoline entry is
+; passed through to main_ap in EDI (low) and ESI (high).
 boot32_ap:
 	cli									; Clear interrupts
 
-	add dword [heap_top], 0x1000		; Allocate stack from heap
-	mov esp, dword [heap_top] 			; Load top of allocated stack
+	mov eax, 0x1000						; Take a stack from the AP stack pool
+	lock xadd dword [smp_stack_next], eax
+	lea esp, [eax + 0x1000]				; Load top of allocated stack
 
 	call boot32_common					; Common bootstrap
 	jmp 0x8:main_ap						; Far jump
@@ -84,8 +92,8 @@ boot32_common:
 	call boot32_panic
 
 .long_mode_supported:
-	mov eax, cr4						; Enable PAE
-	or eax, 1 << 5
+	mov eax, cr4						; Enable PAE and global pages
+	or eax, (1 << 5) | (1 << 7)
 	mov cr4, eax
 
 	in al, 0x92							; Enable A20
@@ -123,37 +131,134 @@ boot32_gdt:
     ret
 
 ; Sets up identity mapping.
+;
+; The identity map covers the highest address in the multiboot memory map
+; (at least 4 GiB), rounded up to whole GiB. When the CPU supports 1 GiB pages
+; it consists of PDPEs only, using the space of the identity PDs as further
+; PDPs. Otherwise 2 MiB pages are used for up to 64 GiB; the remainder is
+; mapped by page_identity_extend once the heap is available.
 boot32_map:
+	call boot32_map_size                   ; Number of GiB to map in ECX
+	mov dword [page_identity_target], ecx
+
+	mov eax, 0x80000001                    ; Check for 1 GiB page support
+	push ecx
+	cpuid
+	pop ecx
+	test edx, (1 << 26)
+	jz .map_2m
+
+	cmp ecx, BOOT32_IDN_1G_MAX             ; Limit to the PDP space
+	jbe .map_1g
+	mov ecx, BOOT32_IDN_1G_MAX
+
+.map_1g:
+	mov dword [page_identity_mapped], ecx
+
+	mov edi, page_pml4                     ; Map a PDP in the PML4 for
+	mov eax, page_idn_pdp                  ; every 512 GiB
+	or eax, 0b11                           ; Present + Writable
+	mov edx, ecx
+	add edx, 511
+	shr edx, 9
+
+.next_pml4e:
+	stosd                                  ; Write lower DWORD of entry
+	add edi, 4                             ; Skip upper DWORD
+	add eax, 0x1000                        ; Advance to next PDP
+	dec edx
+	jnz .next_pml4e
+
+	mov edi, page_idn_pdp                  ; Identity map PDPEs to memory
+	mov eax, 0b10000011                    ; Present + Writable + 1GB pages; start at 0x0
+	xor edx, edx
+
+.next_pdpe_1g:
+	mov dword [edi], eax                   ; Write entry
+	mov dword [edi + 4], edx
+	add edi, 8
+	add eax, 0x40000000                    ; Advance by one 1GB page
+	adc edx, 0
+	dec ecx
+	jnz .next_pdpe_1g
+	ret
+
+.map_2m:
+	cmp ecx, 64                            ; Limit to the 64 PDs
+	jbe .map_2m_limited
+	mov ecx, 64
+
+.map_2m_limited:
+	mov dword [page_identity_mapped], ecx
+
 	mov eax, page_idn_pdp                  ; Map identity PDP in PML4
 	or eax, 0b11                           ; Present + Writable
 	mov dword [page_pml4], eax             ; First entry in PML4
 
 	mov edi, page_idn_pdp                  ; Map PDPEs to PDs
-	mov ecx, 64                            ; Write 64 entries
 	mov eax, page_idn_pd
 	or eax, 0b11
+	push ecx
 
 .next_pdpe:
 	stosd                                  ; Write lower DWORD of entry
 	add edi, 4                             ; Skip upper DWORD
 	add eax, 0x1000                        ; Advance by one page
 	dec ecx                                ; Decrease number of remaining entries
+	jnz .next_pdpe
 
-	cmp ecx, 0                             ; Entries left?
-	jne .next_pdpe
-
-	mov eax, 0b10000011                    ; Present + Writable + 2MB pages; start at 0x0
+	pop ecx                                ; 512 entries per mapped GiB
+	shl ecx, 9
 	mov edi, page_idn_pd                   ; Identity map PDs to memory
-	mov ecx, 512 * 64                      ; 512 entries in 64 PDs
+	mov eax, 0b10000011                    ; Present + Writable + 2MB pages; start at 0x0
+	xor edx, edx
 
 .next_pde:
-	stosd                                  ; Write lower DWORD of entry
-	add edi, 4                             ; Skip upper DWORD
+	mov dword [edi], eax                   ; Write entry
+	mov dword [edi + 4], edx
+	add edi, 8
 	add eax, 0x200000                      ; Advance by one 2MB page
+	adc edx, 0
 	dec ecx	                               ; Decrease number of remaining entries
+	jnz .next_pde
+	ret
 
-	cmp ecx, 0                             ; Entries left?
-	jne .next_pde
+; Determines the size of the identity map from the multiboot memory map.
+;
+; Returns:
+;	ECX number of GiB to identity map (at least 4).
+boot32_map_size:
+	mov ecx, 4                             ; Map at least 4 GiB
+	mov ebx, dword [multiboot_info]
+	test dword [ebx], (1 << 6)             ; Memory map available?
+	jz .done
+
+	mov esi, dword [ebx + 48]              ; Begin of memory map
+	mov edi, esi
+	add edi, dword [ebx + 44]              ; End of memory map
+
+.next_entry:
+	cmp esi, edi
+	jae .done
+
+	mov eax, dword [esi + 4]               ; End of region in EDX:EAX
+	mov edx, dword [esi + 8]
+	add eax, dword [esi + 12]
+	adc edx, dword [esi + 16]
+	add eax, 0x3FFFFFFF                    ; Round up to whole GiB
+	adc edx, 0
+	shrd eax, edx, 30                      ; Number of GiB in EAX
+
+	cmp eax, ecx
+	jbe .skip
+	mov ecx, eax
+
+.skip:
+	add esi, dword [esi]                   ; Advance to next entry
+	add esi, 4
+	jmp .next_entry
+
+.done:
 	ret
 
 ; Writes a message to the screen, then enters an infinite loop.
@@ -52,3 +52,67 @@ void cpu_cpuid(uint32_t code, cpu_cpuid_result_t *result)
             "=d" (result->d) :
             "a" (code));
 }
+
+void cpu_cpuid_sub(uint32_t code, uint32_t subleaf, cpu_cpuid_result_t *result)
+{
+    asm volatile (
+            "cpuid" :
+            "=a" (result->a),
+            "=b" (result->b),
+            "=c" (result->c),
+            "=d" (result->d) :
+            "a" (code),
+            "c" (subleaf));
+}
+
+uint64_t cpu_cr0_read(void)
+{
+    uint64_t cr0;
+    asm volatile ("mov %%cr0, %0" : "=r" (cr0));
+
+    return cr0;
+}
+
+void cpu_cr0_write(uint64_t value)
+{
+    asm volatile ("mov %0, %%cr0" :: "r" (value));
+}
+
+uint64_t cpu_cr4_read(void)
+{
+    uint64_t cr4;
+    asm volatile ("mov %%cr4, %0" : "=r" (cr4));
+
+    return cr4;
+}
+
+void cpu_cr4_write(uint64_t value)
+{
+    asm volatile ("mov %0, %%cr4" :: "r" (value));
+}
+
+void cpu_xcr_write(uint32_t xcr, uint64_t value)
+{
+    uint32_t a = value;
+    uint32_t d = (value >> 32);
+
+    asm volatile ("xsetbv" :: "c" (xcr), "a" (a), "d" (d));
+}
+
+void cpu_monitor(const volatile void *address)
+{
+    asm volatile ("monitor" :: "a" (address), "c" (0), "d" (0));
+}
+
+void cpu_mwait(uint32_t hints, uint32_t extensions)
+{
+    asm volatile ("mwait" :: "a" (hints), "c" (extensions));
+}
+
+uint64_t cpu_tsc_read(void)
+{
+    uint32_t a, d;
+    asm volatile ("rdtsc" : "=a" (a), "=d" (d));
+
+    return (((uint64_t) d) << 32) | a;
+}
@@ -26,6 +26,7 @@
 #include <elf64.h>
 #include <heap.h>
 #include <page.h>
+#include <pool.h>
 #include <stdint.h>
 #include <string.h>
 
@@ -96,6 +97,89 @@ elf64_sym_t *elf64_sym_find(const char *name, void *binary)
     return 0;
 }
 
+elf64_phdr_t *elf64_phdr_find(uint32_t type, void *binary)
+{
+    elf64_ehdr_t *ehdr = (elf64_ehdr_t *) binary;
+
+    size_t i;
+    for (i = 0; i < ehdr->e_phnum; ++i) {
+        elf64_phdr_t *phdr = (elf64_phdr_t *) ((uintptr_t) binary + ehdr->e_phoff + i * ehdr->e_phsize);
+
+        if (type == phdr->p_type) {
+            return phdr;
+        }
+    }
+
+    return 0;
+}
+
+void *elf64_file_address(uint64_t vaddr, size_t size, void *binary)
+{
+    elf64_ehdr_t *ehdr = (elf64_ehdr_t *) binary;
+
+    size_t i;
+    for (i = 0; i < ehdr->e_phnum; ++i) {
+        elf64_phdr_t *phdr = (elf64_phdr_t *) ((uintptr_t) binary + ehdr->e_phoff + i * ehdr->e_phsize);
+
+        if (ELF_PT_LOAD != phdr->p_type || vaddr < phdr->p_vaddr)
+            continue;
+
+        uint64_t offset = vaddr - phdr->p_vaddr;
+
+        if (offset <= phdr->p_filesz && size <= phdr->p_filesz - offset) {
+            return (void *) ((uintptr_t) binary + phdr->p_offset + offset);
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * Allocates and maps the pages in [<begin>, <end>) of a loadable segment and
+ * queues filling them with the parts of the segment's file contents they
+ * cover in the work pool; the remaining bytes are zeroed.
+ *
+ * When the segment requests an alignment of at least 2 MiB, the physical
+ * memory is placed at the same offset modulo 2 MiB as the virtual address,
+ * so the segment can be mapped using large pages.
+ *
+ * @param binary the binary the segment belongs to
+ * @param phdr the program header of the segment
+ * @param begin the page aligned virtual address of the first page
+ * @param end the page aligned virtual address after the last page
+ */
+static void elf64_load_copy(void *binary, elf64_phdr_t *phdr, uintptr_t begin, uintptr_t end)
+{
+    if (begin >= end)
+        return;
+
+    size_t align = (phdr->p_align >= PAGE_SIZE_2M) ? PAGE_SIZE_2M : PAGE_SIZE_4K;
+    size_t skew = begin & (align - 1);
+    uintptr_t target = (uintptr_t) heap_alloc_aligned(end - begin + skew, align) + skew;
+
+    uintptr_t file_begin = phdr->p_vaddr;
+    uintptr_t file_end = phdr->p_vaddr + phdr->p_filesz;
+
+    if (file_begin < begin)
+        file_begin = begin;
+
+    if (file_end > end)
+        file_end = end;
+
+    if (file_begin < file_end) {
+        uintptr_t source = (uintptr_t) binary + phdr->p_offset + (file_begin - phdr->p_vaddr);
+
+        pool_zero((void *) target, file_begin - begin);
+        pool_copy((void *) (target + file_begin - begin), (void *) source, file_end - file_begin);
+        pool_zero((void *) (target + file_end - begin), end - file_end);
+
+    } else {
+        pool_zero((void *) target, end - begin);
+    }
+
+    page_map_range(target, begin, end - begin, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
+}
+
 void elf64_load(void *binary)
 {
     elf64_ehdr_t *ehdr = (elf64_ehdr_t *) binary;
@@ -108,14 +192,19 @@ void elf64_load(void *binary)
             continue;
 
         uintptr_t source = (uintptr_t) binary + phdr->p_offset;
-        uintptr_t target = (uintptr_t) heap_alloc(phdr->p_memsz);
+        uintptr_t begin = phdr->p_vaddr & ~0xFFF;
+        uintptr_t end = (phdr->p_vaddr + phdr->p_memsz + 0xFFF) & ~0xFFF;
 
-        memcpy((void *) target, (void *) source, phdr->p_filesz);
-        memset((void *) (target + phdr->p_filesz), 0, phdr->p_memsz - phdr->p_filesz);
+        // Map pages that are completely backed by the file in place, unless
+        // the segment asks for large pages the image can not be mapped with
+        size_t align_mask = (phdr->p_align >= PAGE_SIZE_2M) ? PAGE_SIZE_2M - 1 : 0xFFF;
+        uintptr_t file_end = (phdr->p_vaddr + phdr->p_filesz) & ~0xFFF;
 
-        size_t offset;
-        for (offset = 0; offset < phdr->p_memsz; offset += 0x1000) {
-            page_map(target + offset, phdr->p_vaddr + offset, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
+        if (0 == ((source ^ phdr->p_vaddr) & align_mask) && file_end > begin) {
+            page_map_range(source & ~0xFFF, begin, file_end - begin, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
+            begin = file_end;
         }
+
+        elf64_load_copy(binary, phdr, begin, end);
     }
 }
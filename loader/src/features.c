@@ -0,0 +1,125 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cpu.h>
+#include <features.h>
+#include <hydrogen.h>
+#include <info.h>
+#include <lapic.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Number of 32 bit feature words at the start of hy_info_cpu_features_t.
+ */
+#define FEATURES_WORD_COUNT 12
+
+void features_detect(void)
+{
+    hy_info_cpu_features_t *features = &info_cpu_features[lapic_cpu_index()];
+    cpu_cpuid_result_t result;
+
+    cpu_cpuid(0x00, &result);
+    uint32_t max_leaf = result.a;
+
+    cpu_cpuid(0x80000000, &result);
+    uint32_t max_ext = result.a;
+
+    cpu_cpuid(FEATURES_LEAF_BASIC, &result);
+    features->basic_ecx = result.c;
+    features->basic_edx = result.d;
+
+    if (max_leaf >= FEATURES_LEAF_EXTENDED) {
+        cpu_cpuid_sub(FEATURES_LEAF_EXTENDED, 0, &result);
+        features->extended_ebx = result.b;
+        features->extended_ecx = result.c;
+        features->extended_edx = result.d;
+
+        if (result.a >= 1) {
+            cpu_cpuid_sub(FEATURES_LEAF_EXTENDED, 1, &result);
+            features->extended_1_eax = result.a;
+        }
+    }
+
+    if (max_leaf >= FEATURES_LEAF_XSAVE) {
+        cpu_cpuid_sub(FEATURES_LEAF_XSAVE, 0, &result);
+        features->xsave_mask_low = result.a;
+        features->xsave_mask_high = result.d;
+
+        cpu_cpuid_sub(FEATURES_LEAF_XSAVE, 1, &result);
+        features->xsave_features = result.a;
+    }
+
+    if (max_ext >= FEATURES_LEAF_EXT_BASIC) {
+        cpu_cpuid(FEATURES_LEAF_EXT_BASIC, &result);
+        features->ext_ecx = result.c;
+        features->ext_edx = result.d;
+    }
+
+    if (max_ext >= FEATURES_LEAF_EXT_POWER) {
+        cpu_cpuid(FEATURES_LEAF_EXT_POWER, &result);
+        features->power_edx = result.d;
+    }
+
+    if (max_leaf >= FEATURES_LEAF_MWAIT) {
+        cpu_cpuid(FEATURES_LEAF_MWAIT, &result);
+        features->mwait_line_min = result.a & 0xFFFF;
+        features->mwait_line_max = result.b & 0xFFFF;
+        features->mwait_flags = result.c;
+        features->mwait_substates = result.d;
+    }
+
+    if (max_leaf >= FEATURES_LEAF_FREQUENCY) {
+        cpu_cpuid(FEATURES_LEAF_FREQUENCY, &result);
+        features->base_mhz = result.a & 0xFFFF;
+        features->max_mhz = result.b & 0xFFFF;
+    }
+}
+
+void features_merge(void)
+{
+    hy_info_cpu_features_t *common = info_cpu_features_common;
+    size_t bsp = lapic_cpu_index();
+    size_t i, j;
+
+    // The parameters are those of the BSP, the feature words are and-ed
+    memcpy(common, &info_cpu_features[bsp], sizeof(hy_info_cpu_features_t));
+
+    uint8_t *common_words = (uint8_t *) common;
+
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        if (0 == (info_cpu[i].flags & HY_INFO_CPU_FLAG_PRESENT))
+            continue;
+
+        uint8_t *words = (uint8_t *) &info_cpu_features[i];
+
+        for (j = 0; j < FEATURES_WORD_COUNT * sizeof(uint32_t); ++j) {
+            if (common_words[j] != words[j])
+                info_root->flags |= HY_INFO_FLAG_HETEROGENEOUS;
+
+            common_words[j] &= words[j];
+        }
+    }
+}
@@ -25,59 +25,111 @@
 
 #include <heap.h>
 #include <info.h>
+#include <lock.h>
+#include <screen.h>
+#include <smp.h>
 #include <stdint.h>
 #include <string.h>
 
 uintptr_t heap_top = 0;
+size_t heap_used = 0;
+uintptr_t heap_reserved_end = 0;
 
 /**
- * Sorts the modules in the info tables by their address in ascending order.
+ * The reserved regions the heap allocates around, sorted by their address in
+ * ascending order.
+ */
+static heap_hole_t heap_holes[HEAP_HOLE_MAX];
+static size_t heap_hole_count = 0;
+
+/**
+ * Lock that protects the heap top against concurrent allocations, as the
+ * allocator has to skip the reserved regions.
+ */
+static lock_t heap_lock = 0;
+
+/**
+ * Checks whether the region [<begin>, <end>) overlaps memory that is owned by
+ * Hydrogen, that is the AP trampoline and Hydrogen's image including the info
+ * tables.
  *
- * This procedure is required in order to prevent clobbering the modules when
- * moving them to an area that is intersecting with the area the modules were
- * originally stored in.
+ * @param begin the address of the first byte of the region
+ * @param end the address of the first byte after the region
+ * @return whether the region overlaps memory owned by Hydrogen
  */
-static void heap_modules_sort(void)
+static bool heap_owned(uintptr_t begin, uintptr_t end)
 {
-    size_t count = info_root->module_count;
-    size_t i, j;
+    extern uint8_t heap_mark;
+    extern uint8_t boot16_begin;
+    extern uint8_t boot16_end;
 
-    if (count > 1) {
-        for (i = 0; i < count - 1; ++i) {
-            uintptr_t min_addr = 0;
-            size_t min_idx = -1;
-
-            for (j = i; i < count; ++j) {
-                hy_info_module_t *mod = &info_module[j];
-                if (mod->address < min_addr) {
-                    min_idx = j;
-                    min_addr = mod->address;
-                }
-            }
+    uintptr_t boot16_length = (uintptr_t) &boot16_end - (uintptr_t) &boot16_begin;
 
-            if (i != min_idx) {
-                hy_info_module_t tmp;
-                memcpy(&tmp, &info_module[i], sizeof(hy_info_module_t));
-                memcpy(&info_module[i], &info_module[min_idx], sizeof(hy_info_module_t));
-                memcpy(&info_module[min_idx], &tmp, sizeof(hy_info_module_t));
-            }
-        }
+    if (begin < SMP_BOOT16_TARGET + boot16_length && end > SMP_BOOT16_TARGET)
+        return true;
+
+    if (begin < (uintptr_t) &heap_mark && end > 0x100000)
+        return true;
+
+    return false;
+}
+
+/**
+ * Reserves the page aligned region that covers [<begin>, <end>), so the heap
+ * will not allocate memory inside of it.
+ *
+ * @param begin the address of the first byte of the region
+ * @param end the address of the first byte after the region
+ */
+static void heap_reserve(uintptr_t begin, uintptr_t end)
+{
+    if (heap_hole_count >= HEAP_HOLE_MAX) {
+        SCREEN_PANIC("Too many reserved regions for the heap.");
     }
+
+    begin &= ~0xFFF;
+    end = (end + 0xFFF) & ~0xFFF;
+
+    size_t i;
+    for (i = heap_hole_count; i > 0 && heap_holes[i - 1].begin > begin; --i) {
+        heap_holes[i] = heap_holes[i - 1];
+    }
+
+    heap_holes[i].begin = begin;
+    heap_holes[i].end = end;
+    ++heap_hole_count;
 }
 
 /**
- * Moves the modules to the end of the heap.
+ * Reserves the regions of the modules that can stay where the bootloader put
+ * them and marks them in the memory map. Modules that overlap memory owned by
+ * Hydrogen are moved to the heap instead.
  */
-static void heap_modules_move(void)
+static void heap_modules_reserve(void)
 {
     size_t i;
     for (i = 0; i < info_root->module_count; ++i) {
-        hy_info_module_t *mod = &info_module[i];
-        void *buffer = heap_alloc(mod->length);
+        hy_info_module_v2_t *mod = &info_module[i];
+
+        if (!heap_owned(mod->address, mod->address + mod->length))
+            heap_reserve(mod->address, mod->address + mod->length);
+    }
+
+    for (i = 0; i < heap_hole_count; ++i) {
+        if (heap_holes[i].end > heap_reserved_end)
+            heap_reserved_end = heap_holes[i].end;
+    }
+
+    for (i = 0; i < info_root->module_count; ++i) {
+        hy_info_module_v2_t *mod = &info_module[i];
 
-        memcpy((void *) buffer, (void *) mod->address, mod->length);
+        if (heap_owned(mod->address, mod->address + mod->length)) {
+            void *buffer = heap_alloc(mod->length);
+            memcpy(buffer, (void *) mod->address, mod->length);
+            mod->address = (uintptr_t) buffer;
+        }
 
-        mod->address = (uintptr_t) buffer;
+        info_mmap_mark(mod->address, mod->address + mod->length, HY_INFO_MMAP_FLAG_MODULE);
     }
 }
 
@@ -86,16 +138,134 @@ void heap_init(void)
 	extern uint8_t heap_mark;
 	heap_top = (uintptr_t) &heap_mark;
 
-	heap_modules_sort();
-	heap_modules_move();
+	heap_modules_reserve();
 }
 
 void *heap_alloc(size_t size)
+{
+	return heap_alloc_aligned(size, 0x1000);
+}
+
+void *heap_alloc_aligned(size_t size, size_t align)
 {
 	size = (size + 0xFFF) & ~0xFFF;
-	uintptr_t chunk = heap_top;
-	heap_top += size;
+
+	lock_acquire(&heap_lock);
+
+	uintptr_t chunk = (heap_top + align - 1) & ~(align - 1);
+	size_t i;
+
+	for (i = 0; i < heap_hole_count; ++i) {
+		heap_hole_t *hole = &heap_holes[i];
+
+		if (chunk < hole->end && chunk + size > hole->begin)
+			chunk = (hole->end + align - 1) & ~(align - 1);
+	}
+
+	heap_top = chunk + size;
+	heap_used += size;
+
+	lock_release(&heap_lock);
 
 	return (void *) chunk;
 }
 
+void *heap_alloc_domain(size_t size, uint32_t domain)
+{
+    size = (size + 0xFFF) & ~0xFFF;
+
+    uintptr_t best = 0;
+    bool local = false;
+    size_t i, j;
+
+    // Search and reserve under the lock, so concurrent allocations do not move
+    // the heap top into the chosen region in the meantime
+    lock_acquire(&heap_lock);
+
+    for (i = 0; i < info_root->numa_mem_count; ++i) {
+        hy_info_numa_mem_t *mem = &info_numa_mem[i];
+
+        if (domain != mem->domain || 0 != (mem->flags & HY_INFO_NUMA_MEM_FLAG_HOTPLUG))
+            continue;
+
+        // The heap is local to this domain anyway
+        if (heap_top >= mem->address && heap_top < mem->address + mem->length) {
+            local = true;
+            break;
+        }
+
+        for (j = 0; j < info_root->mmap_count; ++j) {
+            hy_info_mmap_t *entry = &info_mmap[j];
+
+            if (!entry->available)
+                continue;
+
+            uintptr_t begin = (entry->address > mem->address) ? entry->address : mem->address;
+            uintptr_t end = entry->address + entry->length;
+
+            if (end > mem->address + mem->length)
+                end = mem->address + mem->length;
+
+            end &= ~0xFFF;
+
+            if (begin < heap_top)
+                begin = heap_top;
+
+            if (end < begin + size)
+                continue;
+
+            if (end - size > best)
+                best = end - size;
+        }
+    }
+
+    if (!local && 0 != best)
+        heap_reserve(best, best + size);
+
+    lock_release(&heap_lock);
+
+    if (local || 0 == best)
+        return heap_alloc(size);
+
+    // Marking may grow the memory map on the heap, which takes the lock itself
+    info_mmap_mark(best, best + size, HY_INFO_MMAP_FLAG_CPU);
+
+    return (void *) best;
+}
+
+void heap_alloc_cpus(size_t size, size_t align, void (*place)(size_t, uintptr_t))
+{
+    size_t i, j;
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        if (0 == (info_cpu[i].flags & HY_INFO_CPU_FLAG_PRESENT))
+            continue;
+
+        // Skip domains that have been handled with an earlier CPU
+        uint32_t domain = info_cpu[i].domain;
+        size_t count = 0;
+
+        for (j = 0; j < i; ++j) {
+            if (0 != (info_cpu[j].flags & HY_INFO_CPU_FLAG_PRESENT) && domain == info_cpu[j].domain)
+                break;
+        }
+
+        if (j < i)
+            continue;
+
+        for (j = i; j < info_root->cpu_count; ++j) {
+            if (0 != (info_cpu[j].flags & HY_INFO_CPU_FLAG_PRESENT) && domain == info_cpu[j].domain)
+                ++count;
+        }
+
+        // Over-allocate to align the first chunk
+        uintptr_t physical = (uintptr_t) heap_alloc_domain(size * count + align - 0x1000, domain);
+        physical = (physical + align - 1) & ~(align - 1);
+
+        for (j = i; j < info_root->cpu_count; ++j) {
+            if (0 != (info_cpu[j].flags & HY_INFO_CPU_FLAG_PRESENT) && domain == info_cpu[j].domain) {
+                place(j, physical);
+                physical += size;
+            }
+        }
+    }
+}
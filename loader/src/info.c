@@ -23,59 +23,598 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cpu.h>
 #include <gdt.h>
+#include <heap.h>
 #include <hydrogen.h>
 #include <idt.h>
 #include <info.h>
+#include <screen.h>
 #include <stdint.h>
 #include <string.h>
 
 extern uint8_t info_root_data INFO_SECTION;
-extern uint8_t info_mmap_data INFO_SECTION;
-extern uint8_t info_module_data INFO_SECTION;
-extern uint8_t info_ioapic_data INFO_SECTION;
-extern uint8_t info_strings_data INFO_SECTION;
+extern uint8_t info_dynamic_data INFO_SECTION;
+extern uint8_t info_dynamic_end INFO_SECTION;
 
-hy_info_root_t *info_root = (hy_info_root_t *) &info_root_data;
+static hy_info_root_v2_t info_root_work;
+
+hy_info_root_v2_t *info_root = &info_root_work;
 hy_info_cpu_t *info_cpu = 0;
-hy_info_ioapic_t *info_ioapic = (hy_info_ioapic_t *) &info_ioapic_data;
-hy_info_mmap_t *info_mmap = (hy_info_mmap_t *) &info_mmap_data;
-hy_info_module_t *info_module = (hy_info_module_t *) &info_module_data;
+hy_info_cpu_index_t *info_cpu_index = 0;
+hy_info_cache_t *info_cache = 0;
+uint32_t *info_gsi_cpu = 0;
+hy_info_cluster_t *info_cluster = 0;
+hy_info_mailbox_t *info_mailbox = 0;
+hy_info_work_t *info_work = 0;
+hy_info_cpu_features_t *info_cpu_features = 0;
+hy_info_cpu_features_t *info_cpu_features_common = 0;
+hy_info_ioapic_t *info_ioapic = 0;
+hy_info_mmap_t *info_mmap = 0;
+hy_info_module_v2_t *info_module = 0;
+hy_info_numa_mem_t *info_numa_mem = 0;
+uint8_t *info_numa_distance = 0;
+hy_info_numa_perf_t *info_numa_perf = 0;
+hy_info_phase_v2_t *info_phase_table = 0;
+hy_info_milestone_t *info_milestone = 0;
+char *info_strings = 0;
+
+uintptr_t info_final = 0;
+size_t info_final_size = 0;
 
-char *info_strings = (char *) &info_strings_data;
-char *info_strings_next = (char *) &info_strings_data;
-uint32_t info_string_space = 0x1000;
+static uint32_t info_final_version = 0;
+static size_t info_final_mmap_capacity = 0;
+static size_t info_mmap_capacity = 0;
+static size_t info_string_capacity = 0;
+static uintptr_t info_dynamic_next = (uintptr_t) &info_dynamic_data;
 
 void info_init(void)
 {
     info_root->magic = HY_MAGIC;
-    info_root->length = 0x5000;
+    info_root->version = HY_INFO_VERSION_2;
     
     info_root->idt_paddr = (uintptr_t) &idt_data;
     info_root->gdt_paddr = (uintptr_t) &gdt_data;
 
-    info_root->mmap_offset = ((uintptr_t) info_mmap - (uintptr_t) info_root);
-    info_root->module_offset = ((uintptr_t) info_module - (uintptr_t) info_root);
-    info_root->string_offset = ((uintptr_t) info_strings - (uintptr_t) info_root);
-    info_root->ioapic_offset = ((uintptr_t) info_ioapic - (uintptr_t) info_root);
-
     size_t i;
     for (i = 0; i < 16; ++i) {
         info_root->irq_gsi[i] = i;
     }
+
+    info_strings = (char *) info_alloc(INFO_STRING_SIZE);
+    info_string_capacity = INFO_STRING_SIZE;
+
+    info_phase_table = (hy_info_phase_v2_t *) info_alloc(sizeof(hy_info_phase_v2_t) * INFO_PHASE_MAX);
+}
+
+void *info_alloc(size_t size)
+{
+    size = (size + 0x3F) & ~0x3F;
+
+    void *table;
+
+    if (info_dynamic_next + size <= (uintptr_t) &info_dynamic_end) {
+        table = (void *) info_dynamic_next;
+        info_dynamic_next += size;
+
+    } else if (0 != heap_top) {
+        table = heap_alloc_aligned(size, 0x40);
+
+    } else {
+        SCREEN_PANIC("Info tables exceed the info section.");
+    }
+
+    memset(table, 0, size);
+    return table;
+}
+
+void info_mmap_alloc(size_t count)
+{
+    info_mmap = (hy_info_mmap_t *) info_alloc(sizeof(hy_info_mmap_t) * count);
+    info_mmap_capacity = count;
+}
+
+void info_module_alloc(size_t count)
+{
+    info_module = (hy_info_module_v2_t *) info_alloc(sizeof(hy_info_module_v2_t) * count);
+}
+
+void info_ioapic_alloc(size_t count)
+{
+    info_ioapic = (hy_info_ioapic_t *) info_alloc(sizeof(hy_info_ioapic_t) * count);
+}
+
+void info_cpu_alloc(size_t count)
+{
+    info_cpu = (hy_info_cpu_t *) info_alloc(sizeof(hy_info_cpu_t) * count);
+    info_cpu_index = (hy_info_cpu_index_t *) info_alloc(sizeof(hy_info_cpu_index_t) * count);
+    info_milestone = (hy_info_milestone_t *) info_alloc(sizeof(hy_info_milestone_t) * count);
+    info_cpu_features = (hy_info_cpu_features_t *) info_alloc(sizeof(hy_info_cpu_features_t) * count);
+    info_cpu_features_common = (hy_info_cpu_features_t *) info_alloc(sizeof(hy_info_cpu_features_t));
+    info_mailbox = (hy_info_mailbox_t *) info_alloc(sizeof(hy_info_mailbox_t) * count);
+    info_work = (hy_info_work_t *) info_alloc(sizeof(hy_info_work_t) * count);
+}
+
+void info_cache_alloc(size_t count)
+{
+    info_cache = (hy_info_cache_t *) info_alloc(sizeof(hy_info_cache_t) * count);
+}
+
+void info_gsi_cpu_alloc(size_t count)
+{
+    info_gsi_cpu = (uint32_t *) info_alloc(sizeof(uint32_t) * count);
+}
+
+void info_cluster_alloc(size_t count)
+{
+    info_cluster = (hy_info_cluster_t *) info_alloc(sizeof(hy_info_cluster_t) * count);
+}
+
+/**
+ * Finds the position in the APIC id index at which the given <apic_id> is or
+ * should be inserted.
+ *
+ * @param apic_id the APIC id to search for
+ * @return the position of the first entry with an APIC id not lower than apic_id
+ */
+static size_t info_cpu_search(uint32_t apic_id)
+{
+    size_t low = 0;
+    size_t high = info_root->cpu_count;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+
+        if (info_cpu_index[middle].apic_id < apic_id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return low;
+}
+
+hy_info_cpu_t *info_cpu_add(uint32_t apic_id)
+{
+    size_t count = info_root->cpu_count;
+    size_t position = info_cpu_search(apic_id);
+
+    if (position < count && apic_id == info_cpu_index[position].apic_id)
+        return 0;
+
+    // The MADT usually lists the CPUs in ascending order, so this rarely moves
+    size_t i;
+    for (i = count; i > position; --i) {
+        info_cpu_index[i] = info_cpu_index[i - 1];
+    }
+
+    info_cpu_index[position].apic_id = apic_id;
+    info_cpu_index[position].index = count;
+
+    hy_info_cpu_t *cpu = &info_cpu[count];
+    cpu->apic_id = apic_id;
+
+    info_root->cpu_count = count + 1;
+    return cpu;
+}
+
+size_t info_cpu_find(uint32_t apic_id)
+{
+    size_t position = info_cpu_search(apic_id);
+
+    if (position >= info_root->cpu_count || apic_id != info_cpu_index[position].apic_id)
+        return INFO_CPU_NONE;
+
+    return info_cpu_index[position].index;
+}
+
+/**
+ * Splits the memory map entry at <index> at the given <address>, which must be
+ * inside the entry, into two adjacent entries with the same properties.
+ *
+ * @param index the index of the entry to split
+ * @param address the address at which the second entry begins
+ */
+static void info_mmap_split(size_t index, uintptr_t address)
+{
+    // Grow the memory map by moving it to a table twice its size
+    if (info_root->mmap_count >= info_mmap_capacity) {
+        size_t capacity = (info_mmap_capacity < 16) ? 32 : info_mmap_capacity * 2;
+        hy_info_mmap_t *mmap = (hy_info_mmap_t *) info_alloc(sizeof(hy_info_mmap_t) * capacity);
+
+        memcpy(mmap, info_mmap, sizeof(hy_info_mmap_t) * info_root->mmap_count);
+        info_mmap = mmap;
+        info_mmap_capacity = capacity;
+    }
+
+    size_t i;
+    for (i = info_root->mmap_count; i > index + 1; --i) {
+        memcpy(&info_mmap[i], &info_mmap[i - 1], sizeof(hy_info_mmap_t));
+    }
+
+    ++info_root->mmap_count;
+
+    hy_info_mmap_t *first = &info_mmap[index];
+    hy_info_mmap_t *second = &info_mmap[index + 1];
+
+    memcpy(second, first, sizeof(hy_info_mmap_t));
+    second->address = address;
+    second->length = first->address + first->length - address;
+    first->length = address - first->address;
+}
+
+void info_mmap_mark(uintptr_t begin, uintptr_t end, uint32_t flags)
+{
+    begin &= ~0xFFF;
+    end = (end + 0xFFF) & ~0xFFF;
+
+    size_t i;
+    for (i = 0; i < info_root->mmap_count; ++i) {
+        hy_info_mmap_t *entry = &info_mmap[i];
+        uintptr_t entry_end = entry->address + entry->length;
+
+        if (!entry->available || entry->address >= end || entry_end <= begin)
+            continue;
+
+        // Split off the parts before and after the region
+        if (begin > entry->address) {
+            info_mmap_split(i, begin);
+            ++i;
+        }
+
+        if (end < entry_end) {
+            info_mmap_split(i, end);
+        }
+
+        info_mmap[i].available = 0;
+        info_mmap[i].flags |= flags;
+    }
+}
+
+void info_mmap_domains(void)
+{
+    size_t i, j;
+    for (i = 0; i < info_root->numa_mem_count; ++i) {
+        hy_info_numa_mem_t *mem = &info_numa_mem[i];
+        uintptr_t begin = mem->address & ~0xFFF;
+        uintptr_t end = (mem->address + mem->length) & ~0xFFF;
+
+        for (j = 0; j < info_root->mmap_count; ++j) {
+            hy_info_mmap_t *entry = &info_mmap[j];
+            uintptr_t entry_end = entry->address + entry->length;
+
+            if (entry->address >= end || entry_end <= begin)
+                continue;
+
+            // Split off the parts outside of the range
+            if (begin > entry->address) {
+                info_mmap_split(j, begin);
+                ++j;
+            }
+
+            if (end < entry_end) {
+                info_mmap_split(j, end);
+            }
+
+            info_mmap[j].domain = mem->domain;
+        }
+    }
+}
+
+void info_phase(const char *name)
+{
+    if (info_root->phase_count >= INFO_PHASE_MAX)
+        return;
+
+    hy_info_phase_v2_t *phase = &info_phase_table[info_root->phase_count++];
+    phase->tsc = cpu_tsc_read();
+
+    size_t length = strlen(name);
+    char *string = info_string_alloc(length);
+    memcpy(string, (void *) name, length + 1);
+    phase->name = (uintptr_t) string - (uintptr_t) info_strings;
 }
 
 char *info_string_alloc(size_t length)
 {
     ++length;
 
-    if (length > info_string_space) {
-        // TODO: PANIC
+    // Grow the string table by moving it to a table twice its size
+    if (info_root->string_length + length > info_string_capacity) {
+        size_t capacity = info_string_capacity * 2;
+
+        while (info_root->string_length + length > capacity)
+            capacity *= 2;
+
+        char *strings = (char *) info_alloc(capacity);
+        memcpy(strings, info_strings, info_root->string_length);
+        info_strings = strings;
+        info_string_capacity = capacity;
     }
 
-    char *allocated = info_strings_next;
-    info_strings_next = &info_strings_next[length];
-    info_string_space -= length;
+    char *allocated = &info_strings[info_root->string_length];
+    info_root->string_length += length;
 
     return allocated;
 }
+
+/**
+ * State of a pass that lays out the final info tables behind each other and,
+ * unless only measuring, copies them to their final place.
+ */
+typedef struct info_layout {
+    uintptr_t target;           //< address of the final root (or zero to measure)
+    size_t length;              //< length of the tables laid out so far
+} info_layout_t;
+
+/**
+ * Lays out a table of the given <size> behind the tables laid out so far and
+ * copies the <table> there, unless measuring or <table> is null.
+ *
+ * @param layout the layout pass
+ * @param table the table to copy (or null to leave the space zeroed)
+ * @param size the size of the table in bytes
+ * @return the offset of the table relative to the root
+ */
+static uint32_t info_layout_table(info_layout_t *layout, const void *table, size_t size)
+{
+    uint32_t offset = layout->length;
+    layout->length += (size + 0x3F) & ~0x3F;
+
+    if (0 != layout->target && 0 != table) {
+        memcpy((void *) (layout->target + offset), (void *) table, size);
+    }
+
+    return offset;
+}
+
+/**
+ * Lays out the tables that are shared by both formats and sets their offsets
+ * and counts in the given version 2 <root>.
+ *
+ * Both formats place their CPU and milestone tables in front of these tables,
+ * so this is used to lay out both formats.
+ *
+ * @param layout the layout pass
+ * @param root the root to set the offsets in
+ */
+static void info_layout_common(info_layout_t *layout, hy_info_root_v2_t *root)
+{
+    root->ioapic_offset = info_layout_table(layout, info_ioapic, sizeof(hy_info_ioapic_t) * info_root->ioapic_count);
+    root->string_offset = info_layout_table(layout, info_strings, info_root->string_length);
+    root->numa_mem_offset = info_layout_table(layout, info_numa_mem, sizeof(hy_info_numa_mem_t) * info_root->numa_mem_count);
+
+    size_t domains = info_root->numa_domain_count;
+
+    if (0 != info_numa_distance)
+        root->numa_distance_offset = info_layout_table(layout, info_numa_distance, domains * domains);
+
+    if (0 != info_numa_perf)
+        root->numa_perf_offset = info_layout_table(layout, info_numa_perf, sizeof(hy_info_numa_perf_t) * domains * domains);
+
+    // Reserve space for the entries split off after the tables have been placed
+    root->mmap_offset = info_layout_table(layout, 0, sizeof(hy_info_mmap_t) * info_final_mmap_capacity);
+
+    if (0 != layout->target) {
+        memcpy((void *) (layout->target + root->mmap_offset), info_mmap, sizeof(hy_info_mmap_t) * info_root->mmap_count);
+    }
+}
+
+/**
+ * Lays out the info tables in the version 2 format.
+ *
+ * @param layout the layout pass
+ * @param root the root to set the offsets in
+ */
+static void info_layout_v2(info_layout_t *layout, hy_info_root_v2_t *root)
+{
+    memcpy(root, info_root, sizeof(hy_info_root_v2_t));
+
+    layout->length = (sizeof(hy_info_root_v2_t) + 0x3F) & ~0x3F;
+
+    size_t cpu_count = info_root->cpu_count;
+    root->cpu_offset = info_layout_table(layout, info_cpu, sizeof(hy_info_cpu_t) * cpu_count);
+    root->cpu_index_offset = info_layout_table(layout, info_cpu_index, sizeof(hy_info_cpu_index_t) * cpu_count);
+    root->milestone_offset = info_layout_table(layout, info_milestone, sizeof(hy_info_milestone_t) * cpu_count);
+    info_layout_common(layout, root);
+
+    root->module_offset = info_layout_table(layout, info_module, sizeof(hy_info_module_v2_t) * info_root->module_count);
+    root->phase_offset = info_layout_table(layout, info_phase_table, sizeof(hy_info_phase_v2_t) * info_root->phase_count);
+    root->cache_offset = info_layout_table(layout, info_cache, sizeof(hy_info_cache_t) * info_root->cache_count);
+    root->cpu_features_offset = info_layout_table(layout, info_cpu_features, sizeof(hy_info_cpu_features_t) * info_root->cpu_count);
+    root->cpu_features_common_offset = info_layout_table(layout, info_cpu_features_common, sizeof(hy_info_cpu_features_t));
+    root->gsi_cpu_offset = info_layout_table(layout, info_gsi_cpu, sizeof(uint32_t) * info_root->gsi_count);
+    root->cluster_offset = info_layout_table(layout, info_cluster, sizeof(hy_info_cluster_t) * info_root->cluster_count);
+    root->mailbox_offset = info_layout_table(layout, info_mailbox, sizeof(hy_info_mailbox_t) * info_root->cpu_count);
+    root->work_offset = info_layout_table(layout, info_work, sizeof(hy_info_work_t) * info_root->cpu_count);
+    root->length = layout->length;
+
+    if (0 != layout->target) {
+        memcpy((void *) layout->target, root, sizeof(hy_info_root_v2_t));
+    }
+}
+
+/**
+ * Lays out the info tables in the version 1 format.
+ *
+ * @param layout the layout pass
+ * @param offsets the root to set the offsets in
+ */
+static void info_layout_v1(info_layout_t *layout, hy_info_root_v2_t *offsets)
+{
+    memset(offsets, 0, sizeof(hy_info_root_v2_t));
+
+    layout->length = (sizeof(hy_info_root_t) + 0x3F) & ~0x3F;
+
+    // The CPU and milestone tables are indexed by APIC id
+    size_t cpu_count = 0;
+    size_t i;
+
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        if (info_cpu[i].apic_id >= cpu_count)
+            cpu_count = info_cpu[i].apic_id + 1;
+    }
+
+    if (cpu_count > 0xFFFF) {
+        SCREEN_PANIC("Info tables exceed the version 1 format.");
+    }
+
+    offsets->cpu_offset = info_layout_table(layout, 0, sizeof(hy_info_cpu_v1_t) * cpu_count);
+    offsets->milestone_offset = info_layout_table(layout, 0, sizeof(hy_info_milestone_t) * cpu_count);
+    info_layout_common(layout, offsets);
+
+    size_t module_count = info_root->module_count;
+    size_t phase_count = info_root->phase_count;
+    offsets->module_offset = info_layout_table(layout, 0, sizeof(hy_info_module_t) * module_count);
+    offsets->phase_offset = info_layout_table(layout, 0, sizeof(hy_info_phase_t) * phase_count);
+
+    if (0 == layout->target)
+        return;
+
+    // Convert the CPUs, modules and phases to their version 1 structures
+    hy_info_cpu_v1_t *cpus = (hy_info_cpu_v1_t *) (layout->target + offsets->cpu_offset);
+    hy_info_milestone_t *milestones = (hy_info_milestone_t *) (layout->target + offsets->milestone_offset);
+    hy_info_module_t *modules = (hy_info_module_t *) (layout->target + offsets->module_offset);
+    hy_info_phase_t *phases = (hy_info_phase_t *) (layout->target + offsets->phase_offset);
+
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        hy_info_cpu_t *cpu = &info_cpu[i];
+        hy_info_cpu_v1_t *cpu_v1 = &cpus[cpu->apic_id];
+
+        cpu_v1->apic_id = cpu->apic_id;
+        cpu_v1->acpi_id = cpu->acpi_id;
+        cpu_v1->flags = cpu->flags;
+        cpu_v1->lapic_timer_freq = cpu->lapic_timer_freq;
+        cpu_v1->domain = cpu->domain;
+
+        memcpy(&milestones[cpu->apic_id], &info_milestone[i], sizeof(hy_info_milestone_t));
+    }
+
+    for (i = 0; i < module_count; ++i) {
+        modules[i].name = info_module[i].name;
+        modules[i].address = info_module[i].address;
+        modules[i].length = info_module[i].length;
+    }
+
+    for (i = 0; i < phase_count; ++i) {
+        phases[i].tsc = info_phase_table[i].tsc;
+        phases[i].name = info_phase_table[i].name;
+    }
+
+    hy_info_root_t *root = (hy_info_root_t *) layout->target;
+
+    root->magic = HY_MAGIC;
+    root->flags = info_root->flags;
+    root->length = layout->length;
+
+    root->lapic_paddr = info_root->lapic_paddr;
+    root->rsdp_paddr = info_root->rsdp_paddr;
+    root->idt_paddr = info_root->idt_paddr;
+    root->gdt_paddr = info_root->gdt_paddr;
+    root->tss_paddr = info_root->tss_paddr;
+    root->free_paddr = info_root->free_paddr;
+
+    memcpy(&root->irq_gsi, &info_root->irq_gsi, sizeof(root->irq_gsi));
+    memcpy(&root->irq_flags, &info_root->irq_flags, sizeof(root->irq_flags));
+
+    root->cpu_offset = offsets->cpu_offset;
+    root->ioapic_offset = offsets->ioapic_offset;
+    root->mmap_offset = offsets->mmap_offset;
+    root->module_offset = offsets->module_offset;
+    root->string_offset = offsets->string_offset;
+
+    root->cpu_count_active = info_root->cpu_count_active;
+    root->cpu_count = cpu_count;
+    root->ioapic_count = info_root->ioapic_count;
+    root->mmap_count = info_root->mmap_count;
+    root->module_count = module_count;
+
+    root->phase_offset = offsets->phase_offset;
+    root->milestone_offset = offsets->milestone_offset;
+    root->phase_count = phase_count;
+
+    root->boot_tsc = info_root->boot_tsc;
+    root->pages_mapped = info_root->pages_mapped;
+    root->bytes_copied = info_root->bytes_copied;
+    root->heap_used = info_root->heap_used;
+    root->copy_cycles = info_root->copy_cycles;
+    root->identity_length = info_root->identity_length;
+    root->map_cycles = info_root->map_cycles;
+
+    root->numa_mem_offset = offsets->numa_mem_offset;
+    root->numa_mem_count = info_root->numa_mem_count;
+    root->numa_domain_count = info_root->numa_domain_count;
+    root->numa_distance_offset = offsets->numa_distance_offset;
+    root->numa_perf_offset = offsets->numa_perf_offset;
+}
+
+/**
+ * Lays out the info tables in the format <version> at the given <target>.
+ *
+ * @param target the address of the final root (or zero to measure)
+ * @param version the format version
+ * @param offsets the root to set the offsets of the tables in
+ * @return the length of the tables in bytes
+ */
+static size_t info_layout(uintptr_t target, uint32_t version, hy_info_root_v2_t *offsets)
+{
+    info_layout_t layout = { target, 0 };
+
+    if (HY_INFO_VERSION_2 == version) {
+        info_layout_v2(&layout, offsets);
+    } else {
+        info_layout_v1(&layout, offsets);
+    }
+
+    return layout.length;
+}
+
+void info_place(uint32_t version)
+{
+    if (version > HY_INFO_VERSION_2) {
+        SCREEN_PANIC("Kernel requests an unsupported info table version.");
+    }
+
+    hy_info_root_v2_t offsets;
+
+    info_final_version = version;
+    info_final_mmap_capacity = info_root->mmap_count + INFO_MMAP_RESERVE;
+    info_final_size = info_layout(0, version, &offsets);
+
+    if (HY_INFO_VERSION_2 == version) {
+        info_final = (uintptr_t) heap_alloc_aligned((info_final_size + 0xFFF) & ~0xFFF, 0x1000);
+
+    } else {
+        if (info_final_size > INFO_WINDOW_SIZE) {
+            SCREEN_PANIC("Info tables exceed the version 1 format.");
+        }
+
+        info_final = (uintptr_t) &info_root_data;
+    }
+}
+
+void info_copy(void)
+{
+    if (info_root->mmap_count > info_final_mmap_capacity) {
+        SCREEN_PANIC("Memory map exceeds the space reserved in the info tables.");
+    }
+
+    hy_info_root_v2_t offsets;
+
+    memset((void *) info_final, 0, info_final_size);
+    info_layout(info_final, info_final_version, &offsets);
+
+    info_milestone = (hy_info_milestone_t *) (info_final + offsets.milestone_offset);
+
+    if (HY_INFO_VERSION_2 == info_final_version)
+        info_mailbox = (hy_info_mailbox_t *) (info_final + offsets.mailbox_offset);
+}
+
+hy_info_milestone_t *info_milestone_final(size_t index)
+{
+    if (HY_INFO_VERSION_2 == info_final_version)
+        return &info_milestone[index];
+
+    return &info_milestone[info_cpu[index].apic_id];
+}
@@ -23,13 +23,26 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <elf64.h>
 #include <hydrogen.h>
 #include <info.h>
 #include <ioapic.h>
 #include <kernel.h>
-#include <pit.h>
+#include <lapic.h>
+#include <screen.h>
 #include <stdint.h>
 
+/**
+ * Domain passed to ioapic_route_next() to choose CPUs from all domains.
+ */
+#define IOAPIC_DOMAIN_ANY ((uint32_t) -1)
+
+/**
+ * The kernel's GSI to APIC id table in the kernel binary's file image, after
+ * it has been checked by ioapic_route() (or null pointer if there is none).
+ */
+static uint32_t *ioapic_route_cpus = 0;
+
 static int8_t ioapic_irq_by_gsi(uint32_t gsi)
 {
     size_t irq;
@@ -42,6 +55,197 @@ static int8_t ioapic_irq_by_gsi(uint32_t gsi)
     return -1;
 }
 
+/**
+ * Returns whether the CPU with the given <index> can receive GSIs.
+ *
+ * @param index the index of the CPU in the CPU table
+ * @param domain the NUMA domain the CPU must belong to (or IOAPIC_DOMAIN_ANY)
+ * @param primary whether the CPU must be the first SMT thread of its core
+ */
+static bool ioapic_route_eligible(size_t index, uint32_t domain, bool primary)
+{
+    hy_info_cpu_t *cpu = &info_cpu[index];
+
+    if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT) || cpu->apic_id >= 0xFF)
+        return false;
+
+    if (IOAPIC_DOMAIN_ANY != domain && domain != cpu->domain)
+        return false;
+
+    return !primary || 0 == cpu->smt_id;
+}
+
+/**
+ * Chooses the next CPU to route a GSI to, walking the CPUs in the order of
+ * their APIC ids, so consecutive GSIs are spread over cores and packages.
+ *
+ * Prefers the first SMT thread of each core, then any thread; falls back to
+ * the BSP, if there is no eligible CPU in the <domain>.
+ *
+ * @param cursor the position in the APIC id index to continue at
+ * @param domain the NUMA domain to choose from (or IOAPIC_DOMAIN_ANY)
+ * @return the index of the CPU in the CPU table
+ */
+static size_t ioapic_route_next(size_t *cursor, uint32_t domain)
+{
+    size_t count = info_root->cpu_count;
+    size_t pass, i;
+
+    for (pass = 0; pass < 2; ++pass) {
+        for (i = 0; i < count; ++i) {
+            size_t position = (*cursor + i) % count;
+            size_t index = info_cpu_index[position].index;
+
+            if (ioapic_route_eligible(index, domain, 0 == pass)) {
+                *cursor = position + 1;
+                return index;
+            }
+        }
+    }
+
+    return lapic_cpu_index();
+}
+
+/**
+ * Returns the NUMA domain of an IO APIC: the domain of the NUMA memory range
+ * that contains its MMIO window, or IOAPIC_DOMAIN_ANY, if there is none.
+ *
+ * The SRAT usually only describes RAM, so most IO APICs are not covered and
+ * have their GSIs spread over all CPUs.
+ *
+ * @param ioapic the IO APIC
+ * @return the NUMA domain (or IOAPIC_DOMAIN_ANY)
+ */
+static uint32_t ioapic_domain(hy_info_ioapic_t *ioapic)
+{
+    size_t i;
+
+    for (i = 0; i < info_root->numa_mem_count; ++i) {
+        hy_info_numa_mem_t *range = &info_numa_mem[i];
+
+        if (ioapic->mmio_paddr >= range->address && ioapic->mmio_paddr - range->address < range->length)
+            return range->domain;
+    }
+
+    return IOAPIC_DOMAIN_ANY;
+}
+
+/**
+ * Looks up the CPU of a <gsi> in the kernel's GSI to APIC id table.
+ *
+ * @param gsi the GSI
+ * @return the index of the CPU or INFO_CPU_NONE
+ */
+static size_t ioapic_route_table(uint32_t gsi)
+{
+    if (0 == ioapic_route_cpus || gsi >= KERNEL_HEADER_FIELD(irq_cpu_count))
+        return INFO_CPU_NONE;
+
+    uint32_t apic_id = ioapic_route_cpus[gsi];
+
+    if (HY_HEADER_IRQ_CPU_DEFAULT == apic_id)
+        return INFO_CPU_NONE;
+
+    size_t index = info_cpu_find(apic_id);
+
+    if (INFO_CPU_NONE == index || !ioapic_route_eligible(index, IOAPIC_DOMAIN_ANY, false))
+        return INFO_CPU_NONE;
+
+    return index;
+}
+
+/**
+ * Returns the logical destination for lowest priority delivery.
+ *
+ * In xAPIC mode all CPUs are addressed with 0xFF in the flat model. In x2APIC
+ * mode the 8 bit destination of a redirection (without interrupt remapping)
+ * can only address the first eight CPUs of cluster 0, so the logical bits of
+ * the present ones are used.
+ *
+ * @return the logical destination
+ */
+static uint8_t ioapic_logical_destination(void)
+{
+    if (0 == (info_root->flags & HY_INFO_FLAG_X2APIC))
+        return 0xFF;
+
+    if (0 == info_root->cluster_count || 0 != info_cluster[0].cluster)
+        return 0xFF;
+
+    uint8_t mask = info_cluster[0].logical_mask & 0xFF;
+    return (0 != mask) ? mask : 0xFF;
+}
+
+void ioapic_route(void)
+{
+    size_t i, j;
+    uint32_t gsi_count = 0;
+
+    for (i = 0; i < info_root->ioapic_count; ++i) {
+        hy_info_ioapic_t *ioapic = &info_ioapic[i];
+
+        if (ioapic->gsi_base + ioapic->gsi_count > gsi_count)
+            gsi_count = ioapic->gsi_base + ioapic->gsi_count;
+    }
+
+    info_gsi_cpu_alloc(gsi_count);
+    info_root->gsi_count = gsi_count;
+
+    uint32_t policy = KERNEL_HEADER_FIELD(irq_policy);
+    size_t bsp = lapic_cpu_index();
+    size_t cursor = 0;
+
+    if (policy > HY_HEADER_IRQ_POLICY_TABLE) {
+        SCREEN_PANIC("Kernel requests an unsupported IRQ policy.");
+    }
+
+    uint64_t table = KERNEL_HEADER_FIELD(irq_cpu_table);
+
+    if (HY_HEADER_IRQ_POLICY_TABLE == policy && 0 != table) {
+        size_t size = sizeof(uint32_t) * (size_t) KERNEL_HEADER_FIELD(irq_cpu_count);
+        ioapic_route_cpus = (uint32_t *) elf64_file_address(table, size, kernel_binary);
+
+        if (0 == ioapic_route_cpus) {
+            SCREEN_PANIC("IRQ CPU table lies outside of the kernel binary's segments.");
+        }
+    }
+
+    bool to_bsp = (0 != (kernel_header->flags & HY_HEADER_FLAG_IOAPIC_BSP));
+
+    for (i = 0; i < gsi_count; ++i) {
+        info_gsi_cpu[i] = HY_INFO_GSI_CPU_NONE;
+    }
+
+    for (i = 0; i < info_root->ioapic_count; ++i) {
+        hy_info_ioapic_t *ioapic = &info_ioapic[i];
+        uint32_t domain = IOAPIC_DOMAIN_ANY;
+
+        // Each IO APIC spreads its GSIs over the CPUs of its own domain
+        if (HY_HEADER_IRQ_POLICY_NUMA == policy) {
+            domain = ioapic_domain(ioapic);
+            cursor = 0;
+        }
+
+        for (j = 0; j < ioapic->gsi_count; ++j) {
+            uint32_t gsi = ioapic->gsi_base + j;
+            size_t index = INFO_CPU_NONE;
+
+            if (HY_HEADER_IRQ_POLICY_DEFAULT == policy) {
+                info_gsi_cpu[gsi] = to_bsp ? bsp : HY_INFO_GSI_CPU_NONE;
+                continue;
+            }
+
+            if (HY_HEADER_IRQ_POLICY_TABLE == policy)
+                index = ioapic_route_table(gsi);
+
+            if (INFO_CPU_NONE == index)
+                index = ioapic_route_next(&cursor, domain);
+
+            info_gsi_cpu[gsi] = index;
+        }
+    }
+}
+
 static void ioapic_setup(bool kernel)
 {
     size_t i, j;
@@ -126,9 +330,12 @@ uint64_t ioapic_redir_forge(uint32_t gsi, bool kernel)
 {
     uint64_t redir = IOAPIC_REDIR_LOADER;
 
-    if (kernel) {
-        redir = (0 == (kernel_header->flags & HY_HEADER_FLAG_IOAPIC_BSP))
-                ? IOAPIC_REDIR_KERNEL : IOAPIC_REDIR_KERNEL_BSP;
+    if (kernel && HY_INFO_GSI_CPU_NONE == info_gsi_cpu[gsi]) {
+        redir = IOAPIC_REDIR_KERNEL | ((uint64_t) ioapic_logical_destination() << IOAPIC_REDIR_DEST);
+
+    } else if (kernel) {
+        uint64_t apic_id = info_cpu[info_gsi_cpu[gsi]].apic_id;
+        redir = IOAPIC_REDIR_KERNEL_FIXED | (apic_id << IOAPIC_REDIR_DEST);
     }
 
     int8_t irq = ioapic_irq_by_gsi(gsi);
@@ -177,6 +384,7 @@ uint64_t ioapic_redir_forge(uint32_t gsi, bool kernel)
 
 void ioapic_setup_kernel(void)
 {
+    ioapic_route();
     ioapic_setup(true);
 }
 
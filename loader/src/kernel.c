@@ -23,12 +23,15 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cpu.h>
 #include <elf64.h>
+#include <heap.h>
 #include <hydrogen.h>
 #include <info.h>
 #include <kernel.h>
 #include <lapic.h>
 #include <page.h>
+#include <pool.h>
 #include <screen.h>
 #include <stdint.h>
 #include <string.h>
@@ -37,13 +40,25 @@
 
 void *kernel_binary = 0;
 hy_header_root_t *kernel_header = 0;
+size_t kernel_header_size = 0;
+uintptr_t *kernel_stack_top = 0;
+
+/**
+ * Virtual address of the kernel header in the loaded kernel image.
+ */
+static uintptr_t kernel_header_vaddr = 0;
+
+/**
+ * Size of each CPU's stack in bytes, rounded up to whole pages.
+ */
+static size_t kernel_stack_size = 0;
 
 void kernel_find(void)
 {
     size_t i;
 
     for (i = 0; i < info_root->module_count; ++i) {
-        hy_info_module_t *mod = &info_module[i];
+        hy_info_module_v2_t *mod = &info_module[i];
         char *name = &info_strings[mod->name];
 
         if (strstr(name, KERNEL_NAME) == name) {
@@ -74,31 +89,84 @@ void kernel_analyze(void)
         SCREEN_PANIC("The kernel binary does not provide a Hydrogen header.");
     }
 
-    kernel_header = (hy_header_root_t *) sym->st_value;
+    // Until the kernel is loaded, only the magic and flags are peeked from the
+    // file image; the rest of the header may lie outside its file contents
+    // Headers without a symbol size end with the IRQ array, like the header of
+    // kernels that predate the fields behind it
+    kernel_header_vaddr = sym->st_value;
+    kernel_header_size = sym->st_size;
+
+    if (0 == kernel_header_size) {
+        kernel_header_size = __builtin_offsetof(hy_header_root_t, stack_size);
+    }
+
+    kernel_header = (hy_header_root_t *) elf64_file_address(kernel_header_vaddr, sizeof(uint64_t), kernel_binary);
+
+    if (0 == kernel_header) {
+        SCREEN_PANIC("The kernel header is not part of a loadable segment.");
+    }
 
     if (kernel_header->magic != HY_MAGIC) {
         SCREEN_PANIC("Invalid magic value in kernel header.");
     }
 }
 
-void kernel_map_stack(void)
+void kernel_load(void)
 {
-    if (0 == kernel_header->stack_vaddr)
+    elf64_load(kernel_binary);
+}
+
+void kernel_load_wait(void)
+{
+    pool_wait();
+    kernel_header = (hy_header_root_t *) kernel_header_vaddr;
+
+    if (0 != (kernel_header->flags & HY_HEADER_FLAG_AP_PARK) && HY_INFO_VERSION_2 != KERNEL_HEADER_FIELD(info_version)) {
+        SCREEN_PANIC("AP parking requires the version 2 info table format.");
+    }
+}
+
+/**
+ * Sets the stack of the CPU with the given <index> to the physical memory at
+ * <physical> and maps it to its virtual slot, if the kernel header specifies
+ * a virtual stack address.
+ *
+ * @param index the index of the CPU in the CPU table
+ * @param physical the physical address of the stack
+ */
+static void kernel_stack_place(size_t index, uintptr_t physical)
+{
+    size_t size = kernel_stack_size;
+
+    if (0 == kernel_header->stack_vaddr) {
+        kernel_stack_top[index] = physical + size;
         return;
+    }
 
+    size_t guard = KERNEL_HEADER_FIELD(stack_guard) * 0x1000;
+    uintptr_t virtual = kernel_header->stack_vaddr + index * (size + guard) + guard;
+
+    page_map_range(physical, virtual, size, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
+    kernel_stack_top[index] = virtual + size;
+}
+
+void kernel_setup_stacks(void)
+{
     if (0 != (kernel_header->stack_vaddr & 0xFFF)) {
         SCREEN_PANIC("Virtual stack address in kernel header not page-aligned.");
     }
 
-    uintptr_t stack_begin, stack_address, stack_offset;
-    asm volatile ("mov %%rsp, %0" : "=a" (stack_address));
-    stack_begin = (stack_address - 1) & ~0xFFF;
-    stack_offset = stack_address - stack_begin;
+    kernel_stack_size = KERNEL_HEADER_FIELD(stack_size);
+
+    if (0 == kernel_stack_size)
+        kernel_stack_size = 0x1000;
 
-    uintptr_t stack_target = kernel_header->stack_vaddr + 0x1000 * lapic_id();
-    page_map(stack_address, stack_target, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
+    kernel_stack_size = (kernel_stack_size + 0xFFF) & ~0xFFF;
 
-    asm volatile ("mov %0, %%rsp" :: "a" (stack_target + stack_offset));
+    kernel_stack_top = (uintptr_t *) heap_alloc(sizeof(uintptr_t) * info_root->cpu_count);
+    memset(kernel_stack_top, 0, sizeof(uintptr_t) * info_root->cpu_count);
+
+    heap_alloc_cpus(kernel_stack_size, 0x1000, kernel_stack_place);
 }
 
 void kernel_map_info(void)
@@ -106,15 +174,11 @@ void kernel_map_info(void)
     if (0 == kernel_header->info_vaddr)
         return;
 
-    size_t length = info_root->length;
-    size_t offset;
-
-    uintptr_t physical = (uintptr_t) info_root;
-    uintptr_t virtual = kernel_header->info_vaddr;
-
-    for (offset = 0; offset < length; offset += 0x1000) {
-        page_map(physical + offset, virtual + offset, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
-    }
+    page_map_range(
+        info_final,
+        kernel_header->info_vaddr,
+        (info_final_size + 0xFFF) & ~0xFFF,
+        PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
 }
 
 void kernel_map_idt(void)
@@ -147,18 +211,75 @@ void kernel_map_gdt(void)
     gdt_pointer.address = kernel_header->gdt_vaddr;
 }
 
-extern void kernel_enter(uintptr_t address);
+extern void kernel_enter(uintptr_t address, uintptr_t stack, uintptr_t info, uint64_t argument);
+
+/**
+ * Returns the address of the root info table as seen by the kernel, that is
+ * its virtual address, if the kernel header specifies one.
+ *
+ * @return address of the root info table
+ */
+static uintptr_t kernel_info_address(void)
+{
+    if (0 != kernel_header->info_vaddr)
+        return kernel_header->info_vaddr;
+
+    return info_final;
+}
 
 void kernel_enter_bsp(void)
 {
-    kernel_enter(((elf64_ehdr_t *) kernel_binary)->e_entry);
+    kernel_enter(((elf64_ehdr_t *) kernel_binary)->e_entry, kernel_stack_top[lapic_cpu_index()], kernel_info_address(), 0);
+}
+
+/**
+ * Parks the current AP in its mailbox until the kernel writes an entry
+ * address, then enters the kernel as requested in the mailbox.
+ *
+ * Waits with MONITOR/MWAIT, if supported by all CPUs, or spins with PAUSE.
+ *
+ * @param index the index of the CPU in the CPU table
+ */
+static void kernel_park_ap(size_t index)
+{
+    hy_info_mailbox_t *mailbox = &info_mailbox[index];
+    bool mwait = (0 != (info_cpu_features_common->basic_ecx & (1 << 3)));
+
+    mailbox->state = HY_INFO_MAILBOX_STATE_PARKED;
+
+    while (0 == mailbox->entry) {
+        if (mwait) {
+            cpu_monitor(&mailbox->entry);
+
+            if (0 == mailbox->entry)
+                cpu_mwait(0, 0);
+
+        } else {
+            asm volatile ("pause");
+        }
+    }
+
+    // The entry is written last, so the other fields are valid now
+    uint64_t entry = mailbox->entry;
+    uint64_t stack = mailbox->stack;
+    uint64_t argument = mailbox->argument;
+
+    if (0 == stack)
+        stack = kernel_stack_top[index];
+
+    mailbox->state = HY_INFO_MAILBOX_STATE_RELEASED;
+    kernel_enter(entry, stack, kernel_info_address(), argument);
 }
 
 void kernel_enter_ap(void)
 {
-    if (0 == kernel_header->ap_entry) {
+    size_t index = lapic_cpu_index();
+
+    if (0 != (kernel_header->flags & HY_HEADER_FLAG_AP_PARK)) {
+        kernel_park_ap(index);
+    } else if (0 == kernel_header->ap_entry) {
         while (1) { asm volatile ("hlt"); }
     } else {
-        kernel_enter(kernel_header->ap_entry);
+        kernel_enter(kernel_header->ap_entry, kernel_stack_top[index], kernel_info_address(), 0);
     }
 }
@@ -29,13 +29,19 @@ extern gdt_pointer
 extern idt_address
 extern idt_load
 
-; Resets the stack and jumps to the kernel, given the entry address.
+; Switches to the kernel stack and jumps to the kernel, given the entry address.
 ;
 ; Parameters:
 ;   RDI the entry address
+;   RSI the top of the stack to enter the kernel with
+;   RDX the address of the root info table (passed in RDI)
+;   RCX the argument (passed in RSI)
 ;
 kernel_enter:
     push rdi                        ; Save RDI
+    push rsi                        ; Save RSI
+    push rdx                        ; Save RDX
+    push rcx                        ; Save RCX
 
     mov rax, gdt_pointer            ; Reload GDT
     lgdt [rax]
@@ -44,22 +50,21 @@ kernel_enter:
     mov rsi, 0xFFF
     call idt_load
   
+    pop rcx                         ; Reload RCX
+    pop rdx                         ; Reload RDX
+    pop rsi                         ; Reload RSI
     pop rdi                         ; Reload RDI
   
-    mov rax, rsp                    ; Reset the stack
-    sub rax, 1
-    and rax, ~0xFFF
-    add rax, 0x1000
-    mov rsp, rax
+    mov rsp, rsi                    ; Switch to the kernel stack
     
     push rdi                        ; Push rdi as a return address
+    mov rdi, rdx                    ; Pass the info tables in RDI
+    mov rsi, rcx                    ; Pass the argument in RSI
 
     xor rax, rax                    ; Clear registers
     xor rbx, rbx
     xor rcx, rcx
     xor rdx, rdx
-    xor rsi, rsi
-    xor rdi, rdi
     xor rbp, rbp
     xor r8, r8
     xor r9, r9
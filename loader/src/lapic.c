@@ -25,14 +25,13 @@
 
 #include <apic.h>
 #include <cpu.h>
-#include <idt.h>
 #include <info.h>
 #include <ioapic.h>
 #include <kernel.h>
 #include <lapic.h>
-#include <pit.h>
 #include <screen.h>
 #include <stdint.h>
+#include <timer.h>
 
 #define LAPIC_X2APIC_MODE (0 != (HY_INFO_FLAG_X2APIC & info_root->flags))
 
@@ -95,10 +94,73 @@ void lapic_setup(void)
     lapic_register_write(LAPIC_REG_ERRINT, LAPIC_ERRINT);
 
     if (!LAPIC_X2APIC_MODE) {
+        lapic_register_write(LAPIC_REG_DFR, LAPIC_DFR);
         lapic_register_write(LAPIC_REG_LDR, LAPIC_LDR);
     }
 
     lapic_register_write(LAPIC_REG_SVR, LAPIC_SVR);
+
+    // x2APIC: cluster in bits 31:16, logical bit in bits 15:0
+    hy_info_cpu_t *cpu = &info_cpu[lapic_cpu_index()];
+    uint32_t ldr = lapic_register_read(LAPIC_REG_LDR);
+
+    if (LAPIC_X2APIC_MODE) {
+        cpu->logical_id = ldr;
+        cpu->cluster = ldr >> 16;
+    } else {
+        cpu->logical_id = ldr >> 24;
+        cpu->cluster = 0;
+    }
+}
+
+/**
+ * Builds the cluster table, or only counts the clusters.
+ *
+ * The cluster is part of the APIC id, so the CPUs of a cluster are adjacent in
+ * the APIC id index.
+ *
+ * @param fill whether to fill the cluster table (otherwise only count)
+ * @return the number of clusters
+ */
+static size_t lapic_cluster_build(bool fill)
+{
+    size_t count = 0;
+    uint32_t last = 0;
+    size_t position;
+
+    for (position = 0; position < info_root->cpu_count; ++position) {
+        hy_info_cpu_t *cpu = &info_cpu[info_cpu_index[position].index];
+
+        if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
+            continue;
+
+        if (0 == count || cpu->cluster != last) {
+            last = cpu->cluster;
+
+            if (fill) {
+                info_cluster[count].cluster = last;
+                info_cluster[count].logical_mask = 0;
+                info_cluster[count].cpu_first = position;
+            }
+
+            ++count;
+        }
+
+        if (!fill)
+            continue;
+
+        hy_info_cluster_t *cluster = &info_cluster[count - 1];
+        cluster->logical_mask |= LAPIC_X2APIC_MODE ? (cpu->logical_id & 0xFFFF) : cpu->logical_id;
+        cluster->cpu_count = position - cluster->cpu_first + 1;
+    }
+
+    return count;
+}
+
+void lapic_clusters(void)
+{
+    info_cluster_alloc(lapic_cluster_build(false));
+    info_root->cluster_count = lapic_cluster_build(true);
 }
 
 uint32_t lapic_id(void)
@@ -107,6 +169,17 @@ uint32_t lapic_id(void)
     return (LAPIC_X2APIC_MODE) ? id : (id >> 24);
 }
 
+size_t lapic_cpu_index(void)
+{
+    size_t index = info_cpu_find(lapic_id());
+
+    if (INFO_CPU_NONE == index) {
+        SCREEN_PANIC("CPU is not listed as enabled in the MADT.");
+    }
+
+    return index;
+}
+
 void lapic_eoi(void)
 {
     lapic_register_write(LAPIC_REG_EOI, 0);
@@ -115,6 +188,9 @@ void lapic_eoi(void)
 void lapic_ipi(uint32_t icr_low, uint32_t destination)
 {
     if (!LAPIC_X2APIC_MODE) {
+        while (0 != (lapic_register_read(LAPIC_REG_ICR_LOW) & (1 << LAPIC_ICR_DLV_STATUS)))
+            asm volatile ("pause");
+
         lapic_register_write(LAPIC_REG_ICR_HIGH, (destination & 0xFF) << 24);
         lapic_register_write(LAPIC_REG_ICR_LOW, icr_low);
     } else {
@@ -134,35 +210,51 @@ void lapic_timer_update(uint32_t init_count, uint8_t vector, bool mask, bool per
 
 void lapic_timer_calibrate(void)
 {
-    extern uint32_t lapic_timer_calibrate_worker(void);
-    extern void lapic_timer_calibrate_handler(void);
+    uint64_t window = (timer_tsc_freq * LAPIC_CALIBRATE_TIME) / 1000000;
 
-    uint8_t vector = PIT_VECTOR;
+    lapic_timer_update(0xFFFFFFFF, 0, 1, 0);
 
-    idt_intgate(&idt_data[vector], (uintptr_t) &lapic_timer_calibrate_handler, 0x08, 0x0);
-    pit_freq_set(100);
-    pit_route();
+    uint64_t tsc_begin = cpu_tsc_read();
+    uint32_t count_begin = lapic_register_read(LAPIC_REG_TIMER_CUR);
 
-    uint32_t ticks_per_second = lapic_timer_calibrate_worker();
+    while (cpu_tsc_read() - tsc_begin < window) {
+        asm volatile ("pause");
+    }
 
-    info_cpu[lapic_id()].lapic_timer_freq = ticks_per_second;
+    uint32_t count_end = lapic_register_read(LAPIC_REG_TIMER_CUR);
+    uint64_t tsc_end = cpu_tsc_read();
 
-    pit_mask();
-    idt_setup_loader();
+    uint64_t ticks = count_begin - count_end;
+    uint64_t ticks_per_second = (ticks * timer_tsc_freq) / (tsc_end - tsc_begin);
+
+    hy_info_cpu_t *cpu = &info_cpu[lapic_cpu_index()];
+    cpu->lapic_timer_freq = ticks_per_second;
+    cpu->tsc_freq = timer_tsc_freq;
 }
 
-void lapic_timer_wait(uint64_t time)
+void lapic_timer_start(uint64_t time)
 {
-    extern void lapic_timer_wait_handler(void);
-    extern void lapic_timer_wait_worker(void);
+    uint64_t ticks = ((uint64_t) info_cpu[lapic_cpu_index()].lapic_timer_freq * time) / 1000000;
 
-    uint8_t vector = 0x40;
-    idt_intgate(&idt_data[vector], (uintptr_t) &lapic_timer_wait_handler, 0x8, 0x0);
+    if (ticks > 0xFFFFFFFF) {
+        ticks = 0xFFFFFFFF;
+    } else if (0 == ticks) {
+        ticks = 1;
+    }
+
+    lapic_timer_update(ticks, 0, 1, 0);
+}
 
-    uint64_t ticks = ((uint64_t) info_cpu[lapic_id()].lapic_timer_freq * time) / 1000000;
-    lapic_timer_update(ticks, vector, 0, 0);
+bool lapic_timer_expired(void)
+{
+    return (0 == lapic_register_read(LAPIC_REG_TIMER_CUR));
+}
 
-    lapic_timer_wait_worker();
+void lapic_timer_wait(uint64_t time)
+{
+    lapic_timer_start(time);
 
-    idt_setup_loader();
+    while (!lapic_timer_expired()) {
+        asm volatile ("pause");
+    }
 }
@@ -24,7 +24,8 @@
  */
 
 #include <acpi.h>
-#include <elf64.h>
+#include <cpu.h>
+#include <features.h>
 #include <gdt.h>
 #include <heap.h>
 #include <hydrogen.h>
@@ -35,16 +36,28 @@
 #include <lapic.h>
 #include <main.h>
 #include <multiboot.h>
+#include <page.h>
+#include <percpu.h>
 #include <pic.h>
 #include <screen.h>
+#include <simd.h>
 #include <smp.h>
 #include <stdint.h>
+#include <string.h>
 #include <syscall.h>
+#include <timer.h>
+#include <topology.h>
 
 volatile uint8_t main_entry_barrier = 1;
 
 void main_bsp(void)
 {
+    uint64_t boot_tsc = cpu_tsc_read();
+
+    // Select memory primitives and detect paging features
+    string_init();
+    page_init();
+
     // Print header
     screen_write("Hydrogen v0.2b - http://github.com/farok/H2", 0, 0);
     screen_write("Copyright (c) 2012 by Lukas Heidemann", 0, 1);
@@ -56,19 +69,24 @@ void main_bsp(void)
 
     // Initialize Hydrogen info tables and parse the multiboot tables
     info_init();
+    info_root->boot_tsc = boot_tsc;
     multiboot_parse();
+    info_phase("multiboot");
 
-    // Setup the heap
+    // Setup the heap and extend the identity map, if required
     heap_init();
+    page_identity_extend();
+    info_root->identity_length = (uint64_t) page_identity_mapped * PAGE_SIZE_1G;
+    info_phase("modules");
 
     // Now parse the ACPI tables and analyze the IO APICs
     acpi_parse();
     ioapic_analyze();
+    info_phase("acpi");
 
-    // Find, check and load the kernel binary
+    // Find and check the kernel binary and peek at the flags of its header
     kernel_find();
     kernel_check();
-    elf64_load(kernel_binary);
     kernel_analyze();
 
     // Initialize interrupt controllers
@@ -76,13 +94,45 @@ void main_bsp(void)
     lapic_setup();
     ioapic_setup_loader();
     pic_setup();
+    info_phase("interrupts");
 
-    // Calibrate the LAPIC timer
+    // Determine the TSC frequency and calibrate the LAPIC timer
+    timer_calibrate();
     lapic_timer_calibrate();
-
-    // Boot APs
-    info_cpu[lapic_id()].flags |= HY_INFO_CPU_FLAG_BSP;
-    smp_setup();
+    info_phase("timer");
+
+    // Snapshot topology and features and start booting the APs, which run
+    // their trampoline and calibration while the BSP loads the kernel
+    info_cpu[lapic_cpu_index()].flags |= HY_INFO_CPU_FLAG_BSP;
+    topology_init();
+    topology_detect();
+    features_detect();
+    smp_init();
+
+    // Load the kernel binary; the segments are copied by the work pool, which
+    // the BSP works on during the INIT delay and the APs join once they are up
+    kernel_load();
+    smp_startup();
+    kernel_load_wait();
+    info_phase("kernel");
+
+    // Determine paging features
+    page_detect();
+    page_setup();
+
+    // Allocate and map the stacks and per-CPU areas
+    kernel_setup_stacks();
+    percpu_setup_areas();
+    percpu_setup();
+    info_phase("stacks");
+
+    // Wait for the APs to complete their setup
+    smp_join();
+    topology_index();
+    lapic_clusters();
+    features_merge();
+    simd_detect();
+    info_phase("smp");
 
     // Setup IDT and IOAPIC according to kernel header
     idt_setup_kernel();
@@ -92,38 +142,71 @@ void main_bsp(void)
     syscall_init();
 
     // Setup mapping
-    kernel_map_info();
-    kernel_map_stack();
     kernel_map_idt();
     kernel_map_gdt();
+    info_phase("mapping");
+
+    // Reserve the final info tables in the format requested by the kernel
+    info_place(KERNEL_HEADER_FIELD(info_version));
+    kernel_map_info();
+
+    // Set free address behind the heap and the modules, export the heap usage
+    uintptr_t free_paddr = (heap_top > heap_reserved_end) ? heap_top : heap_reserved_end;
+    info_root->free_paddr = (free_paddr + 0xFFF) & ~0xFFF;
+    info_root->heap_used = heap_used;
+    info_root->pages_mapped = page_mapped_count;
+    info_root->map_cycles = page_map_cycles;
+    page_pool_export();
+    info_root->bytes_copied = memcpy_bytes;
+    info_root->copy_cycles = memcpy_cycles;
 
-    // Set free address
-    info_root->free_paddr = (heap_top + 0xFFF) & ~0xFFF;
+    // Copy the info tables to their final place
+    info_copy();
 
     // Lower main entry barrier and jump to the kernel entry point
     main_entry_barrier = 0;
     kernel_enter_bsp();
 }
 
-void main_ap(void)
+void main_ap(uint32_t tsc_low, uint32_t tsc_high)
 {
+    uint64_t entry_tsc = cpu_tsc_read();
+
     // Load the IDT
     idt_load((uintptr_t) &idt_data, IDT_LENGTH);
 
-    // Enable LAPIC and calibrate the timer
+    // Enable LAPIC, report to the BSP, calibrate the timer and snapshot the topology and features
     lapic_setup();
+    smp_checkin();
+
+    size_t index = lapic_cpu_index();
+    hy_info_milestone_t *milestone = &info_milestone[index];
+    milestone->trampoline_tsc = ((uint64_t) tsc_high << 32) | tsc_low;
+    milestone->entry_tsc = entry_tsc;
+
     lapic_timer_calibrate();
+    milestone->calibrated_tsc = cpu_tsc_read();
+    topology_detect();
+    features_detect();
 
-    // Setup stack mapping
-    kernel_map_stack();
+    // Help the BSP load the kernel and wait for it to be released, then enable
+    // paging features and load the per-CPU area
+    smp_wait_release();
+    page_setup();
+    percpu_setup();
 
     // Setup fast syscall support
     syscall_init();
 
     // Signal complete AP startup
-    ++smp_ready_count;
+    smp_ready();
 
-    // Wait for main entry barrier, then enter the kernel (or halt)
+    // Wait for main entry barrier, enable SSE as decided from the features of
+    // all CPUs, then enter the kernel (or halt); the milestone table has been
+    // moved to its final place in the meantime
     while (main_entry_barrier == 1);
+    asm volatile ("" ::: "memory");
+    simd_setup();
+    info_milestone_final(index)->release_tsc = cpu_tsc_read();
     kernel_enter_ap();
 }
@@ -58,14 +58,37 @@ static void multiboot_align_mmap(hy_info_mmap_t *entry)
     entry->address = aligned_addr;
 }
 
+/**
+ * Counts the entries in the multiboot memory map.
+ *
+ * @param mmap the first entry of the memory map
+ * @param length the length of the memory map in bytes
+ * @return the number of entries
+ */
+static size_t multiboot_count_mmap(multiboot_mmap_t *mmap, size_t length)
+{
+    size_t count = 0;
+
+    while (0 != length) {
+        ++count;
+        length -= mmap->size + sizeof(uint32_t);
+        mmap = (multiboot_mmap_t *) ((uintptr_t) mmap + mmap->size + sizeof(uint32_t));
+    }
+
+    return count;
+}
+
 static void multiboot_parse_mmap(multiboot_mmap_t *mmap, size_t length)
 {
+    info_mmap_alloc(multiboot_count_mmap(mmap, length));
+
     while (0 != length) {
         hy_info_mmap_t *hyentry = &info_mmap[info_root->mmap_count++];
         
         hyentry->address = mmap->address;
         hyentry->length = mmap->length;
         hyentry->available = mmap->type == 1;
+        hyentry->domain = HY_INFO_MMAP_DOMAIN_NONE;
         
         multiboot_align_mmap(hyentry);
         
@@ -77,11 +100,13 @@ static void multiboot_parse_mmap(multiboot_mmap_t *mmap, size_t length)
 static void multiboot_parse_mods(multiboot_mod_t *mods, size_t count)
 {
     size_t i;
+
+    info_module_alloc(count);
     
     for (i = 0; i < count; ++i) {
         multiboot_mod_t *mod = &mods[i];
         
-        hy_info_module_t *hymod = &info_module[info_root->module_count++];
+        hy_info_module_v2_t *hymod = &info_module[info_root->module_count++];
         hymod->address = mod->start;
         hymod->length = mod->end - mod->start;
         
@@ -23,25 +23,143 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <cpu.h>
 #include <heap.h>
 #include <info.h>
+#include <kernel.h>
+#include <lock.h>
 #include <page.h>
+#include <screen.h>
 #include <stdint.h>
 #include <string.h>
 
 static uint64_t *page_struct_get(uintptr_t, uint8_t, bool);
 static uint64_t *page_entry_get(uintptr_t, uint8_t, bool);
+static void page_split(uint64_t *, uint8_t);
 
 /**
- * Returns the physical address of the currently active PML4.
+ * Lock that protects the page structures and the mapping statistics.
  *
- * @return physical address of current PML4
+ * Only the BSP maps pages, as it also maps the stacks and per-CPU areas of the
+ * APs, so the lock is not contended; it keeps page_map_range() safe for callers
+ * on the APs.
  */
-static uint64_t page_pml4_get(void)
+static lock_t page_lock = 0;
+
+size_t page_mapped_count = 0;
+uint64_t page_map_cycles = 0;
+bool page_1g_supported = false;
+uint32_t page_identity_target = 0;
+uint32_t page_identity_mapped = 0;
+
+page_pool_t page_pools[PAGE_POOL_MAX];
+size_t page_pool_count = 0;
+
+/**
+ * End of the pool the page structures are currently allocated from.
+ */
+static uintptr_t page_pool_limit = 0;
+
+void page_init(void)
+{
+	cpu_cpuid_result_t result;
+	cpu_cpuid(0x80000001, &result);
+
+	page_1g_supported = (0 != (result.d & (1 << 26)));
+}
+
+void page_detect(void)
+{
+	if (0 != (cpu_cr4_read() & CPU_CR4_PGE))
+		info_root->flags |= HY_INFO_FLAG_PGE;
+
+	if (0 == (kernel_header->flags & HY_HEADER_FLAG_PCID_ALLOW))
+		return;
+
+	cpu_cpuid_result_t result;
+	cpu_cpuid(0x1, &result);
+
+	if (0 == (result.c & (1 << 17)))
+		return;
+
+	info_root->flags |= HY_INFO_FLAG_PCID;
+
+	cpu_cpuid(0x0, &result);
+
+	if (result.a >= 7) {
+		cpu_cpuid_sub(0x7, 0, &result);
+
+		if (0 != (result.b & (1 << 10)))
+			info_root->flags |= HY_INFO_FLAG_INVPCID;
+	}
+}
+
+void page_setup(void)
+{
+	if (0 != (info_root->flags & HY_INFO_FLAG_PCID))
+		cpu_cr4_write(cpu_cr4_read() | CPU_CR4_PCIDE);
+}
+
+/**
+ * Allocates a zeroed frame for a page structure from the current pool.
+ *
+ * When the current pool is exhausted, a new pool twice the size of the last
+ * one is allocated on the heap.
+ *
+ * @return physical address of the frame
+ */
+static uintptr_t page_pool_alloc(void)
 {
-	uint64_t pml4;
-	asm volatile ("mov %%cr3, %0" : "=a" (pml4));
-	return pml4;
+	if (0 == page_pool_count || page_pools[page_pool_count - 1].end >= page_pool_limit) {
+		if (page_pool_count >= PAGE_POOL_MAX) {
+			SCREEN_PANIC("Page structure pools exhausted.");
+		}
+
+		size_t size = ((size_t) PAGE_POOL_SIZE) << page_pool_count;
+		page_pool_t *pool = &page_pools[page_pool_count++];
+
+		pool->begin = (uintptr_t) heap_alloc(size);
+		pool->end = pool->begin;
+		page_pool_limit = pool->begin + size;
+	}
+
+	page_pool_t *pool = &page_pools[page_pool_count - 1];
+	uintptr_t frame = pool->end;
+	pool->end += 0x1000;
+
+	memset((void *) frame, 0, 0x1000);
+	return frame;
+}
+
+/**
+ * Splits the large page mapped by the given <entry> in a page structure of
+ * level <level> into a structure of the next lower level with entries that
+ * map the same memory with the same flags.
+ *
+ * The PAT bit moves from bit 12 to bit 7 when splitting into a page table.
+ *
+ * @param entry The entry that maps the large page.
+ * @param level The level of the structure the entry is stored in.
+ */
+static void page_split(uint64_t *entry, uint8_t level)
+{
+	uint64_t *child = (uint64_t *) page_pool_alloc();
+	uint64_t flags = *entry & (0xFFF | PAGE_FLAG_PAT_LARGE | PAGE_FLAG_NX) & ~PAGE_FLAG_LARGE;
+	uintptr_t physical = PAGE_PHYSICAL(*entry) & ~(PAGE_LEVEL_SIZE(level) - 1);
+
+	if (level - 1 > PAGE_LEVEL_PT) {
+		flags |= PAGE_FLAG_LARGE;
+
+	} else if (0 != (flags & PAGE_FLAG_PAT_LARGE)) {
+		flags &= ~PAGE_FLAG_PAT_LARGE;
+		flags |= PAGE_FLAG_PAT;
+	}
+
+	size_t i;
+	for (i = 0; i < 512; ++i)
+		child[i] = (physical + i * PAGE_LEVEL_SIZE(level - 1)) | flags;
+
+	*entry = (uintptr_t) child | PAGE_FLAG_PRESENT | PAGE_FLAG_WRITABLE | PAGE_FLAG_USER;
 }
 
 /**
@@ -61,7 +179,7 @@ static uint64_t page_pml4_get(void)
 static uint64_t *page_struct_get(uintptr_t virtual, uint8_t level, bool create)
 {
 	if (PAGE_LEVEL_PML4 == level)
-		return (uint64_t *) page_pml4_get();
+		return page_pml4;
 
 	uint64_t *parent_entry = page_entry_get(virtual, level + 1, create);
 
@@ -70,13 +188,18 @@ static uint64_t *page_struct_get(uintptr_t virtual, uint8_t level, bool create)
 
 	if (0 == (*parent_entry & PAGE_FLAG_PRESENT)) {
 		if (create) {
-			uintptr_t frame = (uintptr_t) heap_alloc(0x1000);
+			uintptr_t frame = page_pool_alloc();
 			uint64_t flags = PAGE_FLAG_PRESENT | PAGE_FLAG_WRITABLE | PAGE_FLAG_USER;
 
 			*parent_entry = frame | flags;
 
-			memset((void *) frame, 0, 0x1000);
+		} else {
+			return 0;
+		}
 
+	} else if (0 != (*parent_entry & PAGE_FLAG_LARGE)) {
+		if (create) {
+			page_split(parent_entry, level + 1);
 		} else {
 			return 0;
 		}
@@ -107,19 +230,113 @@ static uint64_t *page_entry_get(uintptr_t virtual, uint8_t level, bool create)
 	return &pstruct[PAGE_INDEX(virtual, level)];
 }
 
+/**
+ * Returns the entry in the page structure of level <level> that covers the
+ * virtual address <virtual>, creating the structure if required.
+ *
+ * Reuses the structure cached in the <cursor> when it covers the address, and
+ * otherwise walks the page structures and caches the result.
+ *
+ * @param cursor The cursor to use.
+ * @param virtual The virtual address covered by the entry.
+ * @param level The level of the structure the entry is stored in.
+ * @return pointer to the entry
+ */
+static uint64_t *page_cursor_entry(page_cursor_t *cursor, uintptr_t virtual, uint8_t level)
+{
+	uintptr_t base = virtual & ~(PAGE_LEVEL_SIZE(level + 1) - 1);
+
+	if (0 == cursor->table || level != cursor->level || base != cursor->base) {
+		cursor->table = page_struct_get(virtual, level, true);
+		cursor->level = level;
+		cursor->base = base;
+	}
+
+	return &cursor->table[PAGE_INDEX(virtual, level)];
+}
+
 void page_map(uintptr_t physical, uintptr_t virtual, uint64_t flags)
 {
+	page_map_range(physical & ~0xFFF, virtual, 0x1000, flags);
+}
+
+void page_map_range(uintptr_t physical, uintptr_t virtual, size_t length, uint64_t flags)
+{
+	length += physical & 0xFFF;
+	length = (length + 0xFFF) & ~0xFFF;
 	physical &= ~0xFFF;
 	virtual &= ~0xFFF;
 
-	uint64_t *pte = page_entry_get(virtual, PAGE_LEVEL_PT, true);
-	*pte = PAGE_FLAG_PRESENT | flags | physical;
+	uint64_t start = cpu_tsc_read();
+	page_cursor_t cursor = { 0, 0, 0 };
+
+	lock_acquire(&page_lock);
+
+	while (length > 0) {
+		uint8_t level = PAGE_LEVEL_PT;
+
+		if (page_1g_supported && length >= PAGE_SIZE_1G &&
+				0 == ((physical | virtual) & (PAGE_SIZE_1G - 1)))
+			level = PAGE_LEVEL_PDP;
+		else if (length >= PAGE_SIZE_2M && 0 == ((physical | virtual) & (PAGE_SIZE_2M - 1)))
+			level = PAGE_LEVEL_PD;
+
+		uint64_t *entry = page_cursor_entry(&cursor, virtual, level);
+
+		// Keep existing page structures and map into them instead of replacing
+		// them by a large page, which would leak them and leave their entries
+		// in the TLB
+		while (PAGE_LEVEL_PT != level &&
+				PAGE_FLAG_PRESENT == (*entry & (PAGE_FLAG_PRESENT | PAGE_FLAG_LARGE))) {
+			--level;
+			entry = page_cursor_entry(&cursor, virtual, level);
+		}
+
+		uint64_t entry_flags = PAGE_FLAG_PRESENT | flags;
+
+		if (PAGE_LEVEL_PT != level)
+			entry_flags |= PAGE_FLAG_LARGE;
+
+		uint64_t previous = *entry;
+		*entry = entry_flags | physical;
+		++page_mapped_count;
+
+		// Entries that were not present can not be cached in the TLB
+		if (0 != (previous & PAGE_FLAG_PRESENT))
+			page_invalidate(virtual);
+
+		physical += PAGE_LEVEL_SIZE(level);
+		virtual += PAGE_LEVEL_SIZE(level);
+		length -= PAGE_LEVEL_SIZE(level);
+	}
+
+	page_map_cycles += cpu_tsc_read() - start;
+	lock_release(&page_lock);
+}
+
+void page_pool_export(void)
+{
+	size_t i;
+	for (i = 0; i < page_pool_count; ++i) {
+		page_pool_t *pool = &page_pools[i];
+		info_mmap_mark(pool->begin, pool->end, HY_INFO_MMAP_FLAG_PAGING);
+	}
+}
+
+void page_identity_extend(void)
+{
+	if (page_identity_mapped >= page_identity_target)
+		return;
+
+	uintptr_t begin = (uintptr_t) page_identity_mapped * PAGE_SIZE_1G;
+	uintptr_t end = (uintptr_t) page_identity_target * PAGE_SIZE_1G;
 
-	page_invalidate(virtual);
+	page_map_range(begin, begin, end - begin, PAGE_FLAG_WRITABLE);
+	page_identity_mapped = page_identity_target;
 }
 
 void page_invalidate(uintptr_t virtual)
 {
 	virtual &= ~0xFFF;
-	asm volatile ("invlpg %0" :: "m" (virtual));
+	asm volatile ("invlpg (%0)" :: "r" (virtual) : "memory");
 }
@@ -0,0 +1,193 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cpu.h>
+#include <elf64.h>
+#include <heap.h>
+#include <hydrogen.h>
+#include <info.h>
+#include <kernel.h>
+#include <lapic.h>
+#include <page.h>
+#include <percpu.h>
+#include <screen.h>
+#include <stdint.h>
+#include <string.h>
+
+uintptr_t *percpu_base = 0;
+
+/**
+ * Size of the per-CPU area, including the TCB for PT_TLS areas.
+ */
+static size_t percpu_size = 0;
+
+/**
+ * Distance between two per-CPU areas in memory, in bytes.
+ */
+static size_t percpu_stride = 0;
+
+/**
+ * Alignment of the per-CPU areas in bytes (at least page aligned).
+ */
+static size_t percpu_align = 0;
+
+/**
+ * Offset of the base register value from the beginning of an area.
+ */
+static size_t percpu_offset = 0;
+
+/**
+ * Address (in the kernel's file image) and size of the template the areas are
+ * filled with.
+ */
+static uintptr_t percpu_template = 0;
+static size_t percpu_template_size = 0;
+
+/**
+ * Determines the layout of the per-CPU areas from the kernel header or the
+ * kernel's PT_TLS segment.
+ *
+ * @return whether there are per-CPU areas to set up
+ */
+static bool percpu_layout(void)
+{
+    size_t align = KERNEL_HEADER_FIELD(percpu_align);
+
+    if (0 != (kernel_header->flags & HY_HEADER_FLAG_PERCPU_TLS)) {
+        elf64_phdr_t *tls = elf64_phdr_find(ELF_PT_TLS, kernel_binary);
+
+        if (0 == tls)
+            return false;
+
+        align = tls->p_align;
+        percpu_template = tls->p_vaddr;
+        percpu_template_size = tls->p_filesz;
+
+        // The TCB (a pointer to itself) follows the aligned TLS block
+        if (0 == align)
+            align = 1;
+
+        percpu_offset = (tls->p_memsz + align - 1) & ~(align - 1);
+        percpu_size = percpu_offset + sizeof(uint64_t);
+
+    } else {
+        percpu_template = KERNEL_HEADER_FIELD(percpu_template);
+        percpu_template_size = KERNEL_HEADER_FIELD(percpu_template_size);
+        percpu_offset = 0;
+        percpu_size = KERNEL_HEADER_FIELD(percpu_size);
+    }
+
+    if (0 == percpu_size)
+        return false;
+
+    if (percpu_template_size > percpu_size) {
+        SCREEN_PANIC("Per-CPU template is larger than the per-CPU area.");
+    }
+
+    if (0 != percpu_template && 0 != percpu_template_size) {
+        percpu_template = (uintptr_t) elf64_file_address(percpu_template, percpu_template_size, kernel_binary);
+
+        if (0 == percpu_template) {
+            SCREEN_PANIC("Per-CPU template lies outside of the kernel binary's segments.");
+        }
+    }
+
+    if (align < 0x1000)
+        align = 0x1000;
+
+    percpu_align = align;
+    percpu_stride = (percpu_size + align - 1) & ~(align - 1);
+    return true;
+}
+
+/**
+ * Fills the per-CPU area of the CPU with the given <index> at <physical>,
+ * maps it to its virtual slot, if the kernel header specifies a virtual
+ * address for the areas, and records its base.
+ *
+ * @param index the index of the CPU in the CPU table
+ * @param physical the physical address of the area
+ */
+static void percpu_place(size_t index, uintptr_t physical)
+{
+    uintptr_t address = physical;
+    uintptr_t vaddr = KERNEL_HEADER_FIELD(percpu_vaddr);
+
+    if (0 != vaddr) {
+        address = vaddr + index * percpu_stride;
+        page_map_range(physical, address, percpu_stride, PAGE_FLAG_WRITABLE | PAGE_FLAG_GLOBAL);
+    }
+
+    memset((void *) physical, 0, percpu_stride);
+
+    if (0 != percpu_template && 0 != percpu_template_size) {
+        memcpy((void *) physical, (void *) percpu_template, percpu_template_size);
+    }
+
+    percpu_base[index] = address + percpu_offset;
+
+    if (0 != (kernel_header->flags & HY_HEADER_FLAG_PERCPU_TLS)) {
+        *((uint64_t *) (physical + percpu_offset)) = percpu_base[index];
+    }
+}
+
+void percpu_setup_areas(void)
+{
+    if (0 != (kernel_header->flags & HY_HEADER_FLAG_FSGSBASE_ALLOW)) {
+        cpu_cpuid_result_t result;
+        cpu_cpuid(0x0, &result);
+
+        if (result.a >= 7) {
+            cpu_cpuid_sub(0x7, 0, &result);
+
+            if (0 != (result.b & (1 << 0)))
+                info_root->flags |= HY_INFO_FLAG_FSGSBASE;
+        }
+    }
+
+    percpu_base = (uintptr_t *) heap_alloc(sizeof(uintptr_t) * info_root->cpu_count);
+    memset(percpu_base, 0, sizeof(uintptr_t) * info_root->cpu_count);
+
+    if (!percpu_layout())
+        return;
+
+    heap_alloc_cpus(percpu_stride, percpu_align, percpu_place);
+}
+
+void percpu_setup(void)
+{
+    if (0 != (info_root->flags & HY_INFO_FLAG_FSGSBASE))
+        cpu_cr4_write(cpu_cr4_read() | CPU_CR4_FSGSBASE);
+
+    uintptr_t base = percpu_base[lapic_cpu_index()];
+
+    if (0 == base)
+        return;
+
+    cpu_msr_write(PERCPU_MSR_GS_BASE, base);
+
+    if (0 != (kernel_header->flags & HY_HEADER_FLAG_PERCPU_FS))
+        cpu_msr_write(PERCPU_MSR_FS_BASE, base);
+}
@@ -23,39 +23,23 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <apic.h>
-#include <hydrogen.h>
-#include <info.h>
-#include <ioapic.h>
-#include <lapic.h>
 #include <pit.h>
 #include <ports.h>
 #include <stdint.h>
 
-void pit_freq_set(uint16_t freq)
+void pit_oneshot_start(uint16_t count)
 {
-    uint16_t divisor = PIT_FREQ_BASE / freq;
-    outb(PIT_IO_COUNTER, divisor);
-    outb(PIT_IO_COUNTER, divisor >> 8);
-}
+    uint8_t gate = inb(PIT_IO_GATE);
+    gate &= ~PIT_GATE_SPEAKER;
+    gate |= PIT_GATE_ENABLE;
+    outb(PIT_IO_GATE, gate);
 
-static void pit_set_redir(uint64_t redir)
-{
-    uint8_t irq = (0 == (info_root->flags & HY_INFO_FLAG_PCAT_COMPAT)) ? PIT_IRQ : PIT_IRQ_PCAT_COMPAT;
-    uint32_t gsi = info_root->irq_gsi[irq];
-    hy_info_ioapic_t *ioapic = ioapic_get_by_gsi(gsi);
-    uint32_t index = gsi - ioapic->gsi_base;
-    ioapic_redir_set(index, redir, ioapic);
-}
-
-void pit_route(void)
-{
-    uint64_t redir = PIT_VECTOR | ((uint64_t) lapic_id() << IOAPIC_REDIR_DEST);
-    pit_set_redir(redir);
+    outb(PIT_IO_INIT, PIT_CMD_ONESHOT);
+    outb(PIT_IO_CHANNEL2, count);
+    outb(PIT_IO_CHANNEL2, count >> 8);
 }
 
-void pit_mask(void)
+bool pit_oneshot_done(void)
 {
-    uint64_t redir = (1 << IOAPIC_REDIR_MASK);
-    pit_set_redir(redir);
+    return (0 != (inb(PIT_IO_GATE) & PIT_GATE_OUT));
 }
@@ -0,0 +1,141 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cpu.h>
+#include <hydrogen.h>
+#include <info.h>
+#include <lapic.h>
+#include <pool.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * Ring buffer of the queued jobs; job n is stored at n % POOL_JOB_MAX.
+ */
+static pool_job_t pool_jobs[POOL_JOB_MAX];
+
+/**
+ * Number of jobs that have been queued (written by the BSP only).
+ */
+static volatile uint64_t pool_tail = 0;
+
+/**
+ * Number of jobs that have been taken from the queue.
+ */
+static volatile uint64_t pool_head = 0;
+
+/**
+ * Number of jobs that have been completed.
+ */
+static volatile uint64_t pool_done = 0;
+
+/**
+ * Queues a single job, executing jobs on the BSP while the queue is full.
+ *
+ * @param type the job type
+ * @param target the address to write to
+ * @param source the address to copy from
+ * @param length the number of bytes
+ */
+static void pool_push(uint8_t type, uintptr_t target, uintptr_t source, size_t length)
+{
+    // A slot is free once the job in it has been taken
+    while (pool_tail - pool_head >= POOL_JOB_MAX) {
+        pool_work();
+    }
+
+    pool_job_t *job = &pool_jobs[pool_tail % POOL_JOB_MAX];
+    job->type = type;
+    job->target = target;
+    job->source = source;
+    job->length = length;
+
+    __sync_synchronize();
+    pool_tail = pool_tail + 1;
+}
+
+void pool_copy(void *target, void *source, size_t length)
+{
+    size_t offset;
+
+    for (offset = 0; offset < length; offset += POOL_CHUNK_SIZE) {
+        size_t chunk = (length - offset < POOL_CHUNK_SIZE) ? length - offset : POOL_CHUNK_SIZE;
+        pool_push(POOL_JOB_COPY, (uintptr_t) target + offset, (uintptr_t) source + offset, chunk);
+    }
+}
+
+void pool_zero(void *target, size_t length)
+{
+    size_t offset;
+
+    for (offset = 0; offset < length; offset += POOL_CHUNK_SIZE) {
+        size_t chunk = (length - offset < POOL_CHUNK_SIZE) ? length - offset : POOL_CHUNK_SIZE;
+        pool_push(POOL_JOB_ZERO, (uintptr_t) target + offset, 0, chunk);
+    }
+}
+
+bool pool_work(void)
+{
+    pool_job_t job;
+    uint64_t head;
+
+    // Read the job before claiming it: the slot is only reused once the job
+    // has been claimed, in which case the claim fails
+    do {
+        head = pool_head;
+
+        if (head >= pool_tail)
+            return false;
+
+        __sync_synchronize();
+        job = pool_jobs[head % POOL_JOB_MAX];
+    } while (!__sync_bool_compare_and_swap(&pool_head, head, head + 1));
+
+    uint64_t start = cpu_tsc_read();
+
+    if (POOL_JOB_COPY == job.type) {
+        memcpy((void *) job.target, (void *) job.source, job.length);
+    } else {
+        memset((void *) job.target, 0, job.length);
+    }
+
+    hy_info_work_t *stats = &info_work[lapic_cpu_index()];
+    stats->jobs += 1;
+    stats->bytes += job.length;
+    stats->cycles += cpu_tsc_read() - start;
+
+    __sync_fetch_and_add(&pool_done, 1);
+    return true;
+}
+
+void pool_wait(void)
+{
+    while (pool_done != pool_tail) {
+        if (!pool_work())
+            asm volatile ("pause");
+    }
+
+    __sync_synchronize();
+}
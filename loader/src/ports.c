@@ -37,3 +37,10 @@ uint8_t inb(uint16_t port)
     asm volatile ("inb %1, %0" : "=a" (value) : "dN" (port));
     return value;
 }
+
+uint32_t inl(uint16_t port)
+{
+    uint32_t value;
+    asm volatile ("inl %1, %0" : "=a" (value) : "dN" (port));
+    return value;
+}
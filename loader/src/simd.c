@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cpu.h>
+#include <features.h>
+#include <hydrogen.h>
+#include <info.h>
+#include <kernel.h>
+#include <simd.h>
+#include <stdint.h>
+
+/**
+ * Whether to enable SSE (CR4.OSFXSR and CR4.OSXMMEXCPT).
+ */
+static uint8_t simd_sse = 0;
+
+/**
+ * The value to load into XCR0 (or zero to leave XSAVE disabled).
+ */
+static uint64_t simd_xcr0 = 0;
+
+/**
+ * Removes the state components from <xcr0> that can only be enabled together
+ * with other components which are missing.
+ *
+ * @param xcr0 the requested state components
+ * @return the valid subset of the state components
+ */
+static uint64_t simd_xcr0_valid(uint64_t xcr0)
+{
+    if (0 == (xcr0 & SIMD_XCR0_SSE))
+        xcr0 &= ~(uint64_t) SIMD_XCR0_AVX;
+
+    if (SIMD_XCR0_BND != (xcr0 & SIMD_XCR0_BND))
+        xcr0 &= ~(uint64_t) SIMD_XCR0_BND;
+
+    if (0 == (xcr0 & SIMD_XCR0_AVX) || SIMD_XCR0_AVX512 != (xcr0 & SIMD_XCR0_AVX512))
+        xcr0 &= ~(uint64_t) SIMD_XCR0_AVX512;
+
+    if (SIMD_XCR0_AMX != (xcr0 & SIMD_XCR0_AMX))
+        xcr0 &= ~SIMD_XCR0_AMX;
+
+    return xcr0;
+}
+
+void simd_detect(void)
+{
+    hy_info_cpu_features_t *features = info_cpu_features_common;
+
+    if (0 == (kernel_header->flags & HY_HEADER_FLAG_SSE_ENABLE))
+        return;
+
+    simd_sse = 1;
+    info_root->flags |= HY_INFO_FLAG_SSE;
+    info_root->xsave_size = SIMD_FXSAVE_SIZE;
+    simd_setup();
+
+    // XSAVE (CPUID 0x01 ECX bit 26)
+    if (0 == (kernel_header->flags & HY_HEADER_FLAG_XSAVE_ENABLE) || 0 == (features->basic_ecx & (1 << 26)))
+        return;
+
+    uint64_t supported = ((uint64_t) features->xsave_mask_high << 32) | features->xsave_mask_low;
+    uint64_t requested = KERNEL_HEADER_FIELD(xcr0_mask) | SIMD_XCR0_X87 | SIMD_XCR0_SSE;
+
+    simd_xcr0 = simd_xcr0_valid(requested & supported);
+    info_root->flags |= HY_INFO_FLAG_XSAVE;
+    info_root->xcr0 = simd_xcr0;
+
+    // The size of the XSAVE area depends on the XCR0 of the current CPU
+    simd_setup();
+
+    cpu_cpuid_result_t result;
+    cpu_cpuid_sub(FEATURES_LEAF_XSAVE, 0, &result);
+    info_root->xsave_size = result.b;
+}
+
+void simd_setup(void)
+{
+    if (!simd_sse)
+        return;
+
+    // Let SSE instructions execute natively and report SIMD exceptions as #XM
+    cpu_cr0_write((cpu_cr0_read() | CPU_CR0_MP) & ~(uint64_t) (CPU_CR0_EM | CPU_CR0_TS));
+    cpu_cr4_write(cpu_cr4_read() | CPU_CR4_OSFXSR | CPU_CR4_OSXMMEXCPT);
+
+    if (0 == simd_xcr0)
+        return;
+
+    cpu_cr4_write(cpu_cr4_read() | CPU_CR4_OSXSAVE);
+    cpu_xcr_write(0, simd_xcr0);
+}
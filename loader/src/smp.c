@@ -24,31 +24,93 @@
  */
 
 #include <apic.h>
+#include <cpu.h>
+#include <heap.h>
 #include <hydrogen.h>
 #include <info.h>
 #include <lapic.h>
+#include <pool.h>
 #include <smp.h>
 #include <stdint.h>
 #include <string.h>
+#include <timer.h>
 
-volatile uint64_t smp_ready_count;
+volatile uint64_t smp_ready_count = 0;
+volatile uint64_t smp_alive_count = 0;
+volatile uint32_t smp_stack_next = 0;
+volatile uint8_t *smp_state = 0;
+volatile uint8_t smp_released = 0;
 
-static void smp_boot(hy_info_cpu_t *cpu)
+/**
+ * Number of APs that are being booted.
+ */
+static size_t smp_count = 0;
+
+/**
+ * Time stamp at which the INIT or last STARTUP IPIs have been sent.
+ */
+static uint64_t smp_ipi_tsc = 0;
+
+/**
+ * Returns the time (in micro seconds) that has passed since the last IPIs have
+ * been sent.
+ *
+ * @return time since smp_ipi_tsc
+ */
+static uint64_t smp_ipi_elapsed(void)
 {
-    // Send INIT IPI
-    lapic_ipi(LAPIC_IPI_INIT, cpu->apic_id);
+    return ((cpu_tsc_read() - smp_ipi_tsc) * 1000000) / timer_tsc_freq;
+}
 
-    // Wait a moment (10ms)
-    lapic_timer_wait(10 * 1000);
+/**
+ * Checks whether the CPU with the given <index> is an AP that should be booted.
+ *
+ * @param index the index of the CPU in the CPU info table
+ * @return true when the CPU is a present AP, false otherwise
+ */
+static bool smp_is_ap(size_t index)
+{
+    hy_info_cpu_t *cpu = &info_cpu[index];
+
+    if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
+        return false;
+
+    if (0 != (cpu->flags & HY_INFO_CPU_FLAG_BSP))
+        return false;
 
-    // Backup ready count
-    uint64_t ready_new = smp_ready_count + 1;
+    return true;
+}
+
+/**
+ * Sends an IPI to all APs that are still in the SMP_STATE_BOOTING state.
+ *
+ * @param icr_low the lower DWORD of the ICR for the IPI
+ */
+static void smp_ipi_booting(uint32_t icr_low)
+{
+    size_t i;
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        if (SMP_STATE_BOOTING == smp_state[i]) {
+            lapic_ipi(icr_low, info_cpu[i].apic_id);
+        }
+    }
+}
 
-    // Send STARTUP IPI
-    lapic_ipi(LAPIC_IPI_STARTUP(0x1000), cpu->apic_id);
+/**
+ * Waits until <count> APs have checked in or the given <time> (in micro
+ * seconds) has passed.
+ *
+ * @param count the number of APs to wait for
+ * @param time the maximum time to wait in micro seconds
+ */
+static void smp_wait_alive(uint64_t count, uint64_t time)
+{
+    lapic_timer_start(time);
 
-    // Wait for the AP to become ready
-    while (ready_new != smp_ready_count);
+    while (smp_alive_count < count && !lapic_timer_expired()) {
+        if (!pool_work())
+            asm volatile ("pause");
+    }
 }
 
 static void smp_prepare_boot16(void)
@@ -60,20 +122,134 @@ static void smp_prepare_boot16(void)
     memcpy((void *) SMP_BOOT16_TARGET, &boot16_begin, length);
 }
 
-void smp_setup(void)
+/**
+ * Allocates the stacks and state slots for the APs.
+ *
+ * @param count the number of APs to boot
+ */
+static void smp_prepare_aps(size_t count)
 {
-    smp_prepare_boot16();
+    smp_stack_next = (uintptr_t) heap_alloc(SMP_STACK_SIZE * count);
+
+    smp_state = (volatile uint8_t *) heap_alloc(info_root->cpu_count);
+    memset((void *) smp_state, SMP_STATE_NONE, info_root->cpu_count);
+
+    size_t i;
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        if (smp_is_ap(i)) {
+            smp_state[i] = SMP_STATE_BOOTING;
+        }
+    }
+}
+
+/**
+ * Marks all APs that did not check in as not present.
+ *
+ * An AP that checks in after it has been marked will halt (see smp_checkin()).
+ */
+static void smp_mark_dead(void)
+{
+    size_t i;
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        if (__sync_bool_compare_and_swap(&smp_state[i], SMP_STATE_BOOTING, SMP_STATE_DEAD)) {
+            info_cpu[i].flags &= ~HY_INFO_CPU_FLAG_PRESENT;
+            --info_root->cpu_count_active;
+        }
+    }
+}
 
+void smp_init(void)
+{
     size_t i;
+
     for (i = 0; i < info_root->cpu_count; ++i) {
-        hy_info_cpu_t *cpu = &info_cpu[i];
+        if (smp_is_ap(i)) {
+            ++smp_count;
+        }
+    }
+
+    if (0 == smp_count)
+        return;
+
+    smp_prepare_boot16();
+    smp_prepare_aps(smp_count);
+
+    // INIT all APs; the BSP continues while they settle
+    smp_ipi_booting(LAPIC_IPI_INIT);
+    smp_ipi_tsc = cpu_tsc_read();
+}
+
+void smp_startup(void)
+{
+    if (0 == smp_count)
+        return;
+
+    // Wait for the remainder of the 10ms after the INIT IPIs, working on the
+    // pool in the meantime
+    uint64_t elapsed = smp_ipi_elapsed();
+
+    if (elapsed < SMP_INIT_DELAY) {
+        lapic_timer_start(SMP_INIT_DELAY - elapsed);
+
+        while (!lapic_timer_expired()) {
+            if (!pool_work())
+                asm volatile ("pause");
+        }
+    }
+
+    // Send the STARTUP IPI and repeat it for APs that missed the first one
+    smp_ipi_booting(LAPIC_IPI_STARTUP(SMP_BOOT16_TARGET));
+    smp_wait_alive(smp_count, 200);
+    smp_ipi_booting(LAPIC_IPI_STARTUP(SMP_BOOT16_TARGET));
+    smp_ipi_tsc = cpu_tsc_read();
+}
+
+void smp_join(void)
+{
+    if (0 == smp_count)
+        return;
+
+    // Wait for the remainder of the timeout, then give up on the APs that did
+    // not respond in time
+    uint64_t elapsed = smp_ipi_elapsed();
 
-        if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
-            continue;
+    if (elapsed < SMP_TIMEOUT)
+        smp_wait_alive(smp_count, SMP_TIMEOUT - elapsed);
 
-        if (0 != (cpu->flags & HY_INFO_CPU_FLAG_BSP))
-            continue;
+    smp_mark_dead();
 
-        smp_boot(cpu);
+    // Release the APs into the second part of their setup and wait for them
+    __sync_synchronize();
+    smp_released = 1;
+
+    while (smp_ready_count != smp_alive_count) {
+        asm volatile ("pause");
     }
 }
+
+void smp_checkin(void)
+{
+    size_t index = lapic_cpu_index();
+
+    if (!__sync_bool_compare_and_swap(&smp_state[index], SMP_STATE_BOOTING, SMP_STATE_ALIVE)) {
+        // Too late: The BSP has already given up on this CPU
+        while (1) { asm volatile ("cli; hlt"); }
+    }
+
+    __sync_fetch_and_add(&smp_alive_count, 1);
+}
+
+void smp_wait_release(void)
+{
+    while (0 == smp_released) {
+        if (!pool_work())
+            asm volatile ("pause");
+    }
+
+    __sync_synchronize();
+}
+
+void smp_ready(void)
+{
+    __sync_fetch_and_add(&smp_ready_count, 1);
+}
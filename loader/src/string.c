@@ -23,8 +23,97 @@
  * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <string.h>
+#include <cpu.h>
 #include <stdint.h>
+#include <string.h>
+
+volatile size_t memcpy_bytes = 0;
+volatile uint64_t memcpy_cycles = 0;
+uint8_t string_method = STRING_METHOD_GENERIC;
+
+void string_init(void)
+{
+    cpu_cpuid_result_t result;
+    cpu_cpuid(0, &result);
+
+    if (result.a < 7)
+        return;
+
+    // ERMS (EBX bit 9) or FSRM (EDX bit 4)
+    cpu_cpuid_sub(7, 0, &result);
+
+    if ((result.b & (1 << 9)) || (result.d & (1 << 4)))
+        string_method = STRING_METHOD_ERMS;
+}
+
+/**
+ * Copies <length> bytes from <src> to <dest> using rep movsb.
+ */
+static void memcpy_bytewise(void *dest, void *src, size_t length)
+{
+    asm volatile (
+            "rep movsb" :
+            "+D" (dest), "+S" (src), "+c" (length) ::
+            "memory");
+}
+
+/**
+ * Copies <length> bytes from <src> to <dest> using rep movsq, followed by
+ * rep movsb for the remaining bytes.
+ */
+static void memcpy_generic(void *dest, void *src, size_t length)
+{
+    size_t qwords = length >> 3;
+    size_t bytes = length & 0x7;
+
+    asm volatile (
+            "rep movsq\n"
+            "mov %3, %%rcx\n"
+            "rep movsb" :
+            "+D" (dest), "+S" (src), "+c" (qwords) :
+            "r" (bytes) :
+            "memory");
+}
+
+/**
+ * Copies <length> bytes from <src> to <dest> using non-temporal stores
+ * (movnti) for all whole 32 byte blocks after the destination has been
+ * aligned. The stores are fenced before returning.
+ */
+static void memcpy_nt(void *dest, void *src, size_t length)
+{
+    size_t head = (-(uintptr_t) dest) & 0x1F;
+    memcpy_bytewise(dest, src, head);
+
+    dest = (void *) ((uintptr_t) dest + head);
+    src = (void *) ((uintptr_t) src + head);
+    length -= head;
+
+    size_t blocks = length >> 5;
+    size_t tail = length & 0x1F;
+
+    if (0 != blocks) {
+        asm volatile (
+                "1:\n"
+                "mov 0(%1), %%rax\n"
+                "mov 8(%1), %%r8\n"
+                "mov 16(%1), %%r9\n"
+                "mov 24(%1), %%r10\n"
+                "movnti %%rax, 0(%0)\n"
+                "movnti %%r8, 8(%0)\n"
+                "movnti %%r9, 16(%0)\n"
+                "movnti %%r10, 24(%0)\n"
+                "add $32, %1\n"
+                "add $32, %0\n"
+                "dec %2\n"
+                "jnz 1b\n"
+                "sfence" :
+                "+r" (dest), "+r" (src), "+r" (blocks) ::
+                "rax", "r8", "r9", "r10", "memory");
+    }
+
+    memcpy_bytewise(dest, src, tail);
+}
 
 uintptr_t memalign(uintptr_t address, size_t boundary)
 {
@@ -48,18 +137,41 @@ bool memcmp(void *a, void *b, size_t len)
 
 void memcpy(void *dest, void *src, size_t length)
 {
-    size_t i;
+    uint64_t start = cpu_tsc_read();
+
+    if (length >= STRING_NT_THRESHOLD)
+        memcpy_nt(dest, src, length);
+    else if (STRING_METHOD_ERMS == string_method)
+        memcpy_bytewise(dest, src, length);
+    else
+        memcpy_generic(dest, src, length);
 
-    for (i = 0; i < length; ++i)
-        ((uint8_t *) dest)[i] = ((uint8_t *) src)[i];
+    __sync_fetch_and_add(&memcpy_cycles, cpu_tsc_read() - start);
+    __sync_fetch_and_add(&memcpy_bytes, length);
 }
 
 void memset(void *dest, uint8_t c, size_t length)
 {
-    size_t i;
-
-    for (i = 0; i < length; ++i)
-        ((uint8_t *) dest)[i] = c;
+    if (STRING_METHOD_ERMS == string_method) {
+        asm volatile (
+                "rep stosb" :
+                "+D" (dest), "+c" (length) :
+                "a" (c) :
+                "memory");
+
+    } else {
+        uint64_t pattern = 0x0101010101010101 * c;
+        size_t qwords = length >> 3;
+        size_t bytes = length & 0x7;
+
+        asm volatile (
+                "rep stosq\n"
+                "mov %2, %%rcx\n"
+                "rep stosb" :
+                "+D" (dest), "+c" (qwords) :
+                "r" (bytes), "a" (pattern) :
+                "memory");
+    }
 }
 
 uint8_t strcmp(const int8_t *a, const int8_t *b)
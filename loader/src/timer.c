@@ -0,0 +1,195 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <acpi.h>
+#include <cpu.h>
+#include <pit.h>
+#include <ports.h>
+#include <stdint.h>
+#include <timer.h>
+
+uint64_t timer_tsc_freq = 0;
+uint8_t timer_source = TIMER_SOURCE_NONE;
+
+static uintptr_t timer_hpet_base = 0;
+static uint16_t timer_pm_port = 0;
+
+/**
+ * Determines the TSC frequency from the crystal clock ratio reported by
+ * CPUID leaf 0x15, deriving the crystal clock from the base frequency in
+ * leaf 0x16 when leaf 0x15 does not report it.
+ *
+ * @return the TSC frequency in Hz or zero if CPUID does not report it
+ */
+static uint64_t timer_tsc_cpuid(void)
+{
+    cpu_cpuid_result_t cpuid;
+    cpu_cpuid(0x0, &cpuid);
+    uint32_t max_leaf = cpuid.a;
+
+    if (max_leaf < 0x15)
+        return 0;
+
+    cpu_cpuid(0x15, &cpuid);
+    uint64_t denominator = cpuid.a;
+    uint64_t numerator = cpuid.b;
+    uint64_t crystal = cpuid.c;
+
+    if (0 == denominator || 0 == numerator)
+        return 0;
+
+    if (0 == crystal && max_leaf >= 0x16) {
+        cpu_cpuid(0x16, &cpuid);
+        crystal = ((uint64_t) (cpuid.a & 0xFFFF) * 1000000 * denominator) / numerator;
+    }
+
+    return (crystal * numerator) / denominator;
+}
+
+static uint64_t timer_hpet_read(void)
+{
+    return *((volatile uint64_t *) (timer_hpet_base + TIMER_HPET_REG_COUNTER));
+}
+
+static uint64_t timer_pm_read(void)
+{
+    return inl(timer_pm_port);
+}
+
+/**
+ * Measures the TSC against a free running reference counter.
+ *
+ * @param read function that reads the reference counter
+ * @param freq frequency of the reference counter in Hz
+ * @param mask mask of the valid bits of the reference counter
+ * @param time the time to measure in micro seconds
+ * @return the TSC frequency in Hz
+ */
+static uint64_t timer_tsc_measure(uint64_t (*read)(void), uint64_t freq, uint64_t mask, uint64_t time)
+{
+    uint64_t ticks = (freq * time) / 1000000;
+    uint64_t ref_begin, ref_elapsed, tsc_begin, tsc_end;
+
+    // Synchronize with an edge of the reference counter
+    ref_begin = read();
+    while (read() == ref_begin);
+
+    ref_begin = read();
+    tsc_begin = cpu_tsc_read();
+
+    do {
+        ref_elapsed = (read() - ref_begin) & mask;
+    } while (ref_elapsed < ticks);
+
+    tsc_end = cpu_tsc_read();
+
+    return ((tsc_end - tsc_begin) * freq) / ref_elapsed;
+}
+
+/**
+ * Measures the TSC against the HPET's main counter.
+ *
+ * @return the TSC frequency in Hz or zero if there is no usable HPET
+ */
+static uint64_t timer_tsc_hpet(void)
+{
+    if (0 == acpi_hpet || ACPI_GAS_SPACE_MEMORY != acpi_hpet->base_address.space_id)
+        return 0;
+
+    timer_hpet_base = acpi_hpet->base_address.address;
+
+    volatile uint64_t *caps = (volatile uint64_t *) (timer_hpet_base + TIMER_HPET_REG_CAPS);
+    volatile uint64_t *config = (volatile uint64_t *) (timer_hpet_base + TIMER_HPET_REG_CONFIG);
+
+    uint64_t period = *caps >> 32; // in femtoseconds
+
+    if (0 == period || period > 100000000)
+        return 0;
+
+    *config |= TIMER_HPET_CONFIG_EN;
+
+    uint64_t freq = 1000000000000000ULL / period;
+    uint64_t mask = (0 != (*caps & TIMER_HPET_CAPS_COUNT_64)) ? ~0ULL : 0xFFFFFFFF;
+    return timer_tsc_measure(&timer_hpet_read, freq, mask, TIMER_WINDOW_HPET);
+}
+
+/**
+ * Measures the TSC against the ACPI power management timer.
+ *
+ * @return the TSC frequency in Hz or zero if there is no PM timer
+ */
+static uint64_t timer_tsc_pm(void)
+{
+    if (0 == acpi_fadt)
+        return 0;
+
+    if (0 != acpi_fadt->pm_tmr_blk && 4 == acpi_fadt->pm_tmr_len) {
+        timer_pm_port = acpi_fadt->pm_tmr_blk;
+
+    } else if (acpi_fadt->header.length >= sizeof(acpi_fadt_t) &&
+            ACPI_GAS_SPACE_IO == acpi_fadt->x_pm_tmr_blk.space_id &&
+            0 != acpi_fadt->x_pm_tmr_blk.address) {
+        timer_pm_port = acpi_fadt->x_pm_tmr_blk.address;
+
+    } else {
+        return 0;
+    }
+
+    uint64_t mask = (0 != (acpi_fadt->flags & ACPI_FADT_TMR_VAL_EXT)) ? 0xFFFFFFFF : 0xFFFFFF;
+    return timer_tsc_measure(&timer_pm_read, ACPI_PM_TIMER_FREQ, mask, TIMER_WINDOW_PM);
+}
+
+/**
+ * Measures the TSC against a one-shot countdown on channel 2 of the PIT.
+ *
+ * @return the TSC frequency in Hz
+ */
+static uint64_t timer_tsc_pit(void)
+{
+    uint64_t ticks = ((uint64_t) PIT_FREQ_BASE * TIMER_WINDOW_PIT) / 1000000;
+
+    pit_oneshot_start(ticks);
+    uint64_t tsc_begin = cpu_tsc_read();
+
+    while (!pit_oneshot_done());
+
+    uint64_t tsc_end = cpu_tsc_read();
+
+    return ((tsc_end - tsc_begin) * PIT_FREQ_BASE) / ticks;
+}
+
+void timer_calibrate(void)
+{
+    if (0 != (timer_tsc_freq = timer_tsc_cpuid())) {
+        timer_source = TIMER_SOURCE_CPUID;
+    } else if (0 != (timer_tsc_freq = timer_tsc_hpet())) {
+        timer_source = TIMER_SOURCE_HPET;
+    } else if (0 != (timer_tsc_freq = timer_tsc_pm())) {
+        timer_source = TIMER_SOURCE_PM;
+    } else {
+        timer_tsc_freq = timer_tsc_pit();
+        timer_source = TIMER_SOURCE_PIT;
+    }
+}
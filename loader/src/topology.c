@@ -0,0 +1,408 @@
+/**
+ * Copyright (c) 2012 by Lukas Heidemann <lukasheidemann@gmail.com>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cpu.h>
+#include <heap.h>
+#include <hydrogen.h>
+#include <info.h>
+#include <lapic.h>
+#include <stdint.h>
+#include <string.h>
+#include <topology.h>
+
+/**
+ * The caches recorded by each CPU, indexed like the CPU table, with
+ * TOPOLOGY_CACHE_MAX entries per CPU.
+ */
+static topology_cache_t *topology_caches = 0;
+
+/**
+ * Number of distinct cache keys (level and type).
+ */
+#define TOPOLOGY_CACHE_KEYS 32
+
+/**
+ * Maps a cache's level and type to a key below TOPOLOGY_CACHE_KEYS.
+ */
+#define TOPOLOGY_CACHE_KEY(cache) ((((cache)->level & 0x7) << 2) | ((cache)->type & 0x3))
+
+/**
+ * Returns the number of bits required to encode <count> distinct ids.
+ *
+ * @param count the number of ids
+ * @return ceil(log2(count))
+ */
+static uint32_t topology_bits(uint32_t count)
+{
+    uint32_t bits = 0;
+
+    while (bits < 32 && (1u << bits) < count)
+        ++bits;
+
+    return bits;
+}
+
+/**
+ * Decodes the APIC id layout using the extended topology leaf <leaf>.
+ *
+ * @param leaf the extended topology leaf (0x1F or 0x0B)
+ * @param smt_shift the number of APIC id bits for the SMT id
+ * @param die_shift the number of APIC id bits below the die id
+ * @param package_shift the number of APIC id bits below the package id
+ * @return whether the leaf is supported
+ */
+static uint8_t topology_decode_extended(uint32_t leaf, uint32_t *smt_shift,
+    uint32_t *die_shift, uint32_t *package_shift)
+{
+    cpu_cpuid_result_t result;
+    uint32_t subleaf;
+    uint32_t shift = 0;
+
+    // The leaf is unsupported when the first level is empty
+    cpu_cpuid_sub(leaf, 0, &result);
+    if (0 == (result.b & 0xFFFF))
+        return 0;
+
+    *smt_shift = 0;
+    *die_shift = 0;
+
+    for (subleaf = 0; subleaf < 0x100; ++subleaf) {
+        cpu_cpuid_sub(leaf, subleaf, &result);
+
+        uint32_t type = (result.c >> 8) & 0xFF;
+        if (TOPOLOGY_LEVEL_INVALID == type)
+            break;
+
+        // The shift of each level is the number of bits below the next level
+        uint32_t level_shift = result.a & 0x1F;
+
+        if (TOPOLOGY_LEVEL_SMT == type)
+            *smt_shift = level_shift;
+
+        if (type < TOPOLOGY_LEVEL_DIE)
+            *die_shift = level_shift;
+
+        shift = level_shift;
+    }
+
+    *package_shift = shift;
+    return 1;
+}
+
+/**
+ * Decodes the APIC id layout using the legacy leaves.
+ *
+ * @param max_leaf the maximum basic CPUID leaf
+ * @param smt_shift the number of APIC id bits for the SMT id
+ * @param package_shift the number of APIC id bits below the package id
+ */
+static void topology_decode_legacy(uint32_t max_leaf, uint32_t *smt_shift,
+    uint32_t *package_shift)
+{
+    cpu_cpuid_result_t result;
+
+    *smt_shift = 0;
+    *package_shift = 0;
+
+    // Without HTT, there is a single logical processor per package
+    cpu_cpuid(0x01, &result);
+    if (0 == (result.d & (1 << 28)))
+        return;
+
+    *package_shift = topology_bits((result.b >> 16) & 0xFF);
+
+    // Intel: cores per package from the deterministic cache parameters
+    if (max_leaf >= TOPOLOGY_LEAF_CACHE) {
+        cpu_cpuid_sub(TOPOLOGY_LEAF_CACHE, 0, &result);
+
+        if (0 != (result.a & 0x1F)) {
+            uint32_t core_shift = topology_bits(((result.a >> 26) & 0x3F) + 1);
+            *smt_shift = (*package_shift > core_shift) ? *package_shift - core_shift : 0;
+            return;
+        }
+    }
+
+    // AMD: core id size from the extended leaves
+    cpu_cpuid(0x80000000, &result);
+    uint32_t max_ext = result.a;
+
+    if (max_ext >= TOPOLOGY_LEAF_EXT_SIZE) {
+        cpu_cpuid(TOPOLOGY_LEAF_EXT_SIZE, &result);
+        uint32_t core_size = (result.c >> 12) & 0xF;
+
+        *package_shift = (0 != core_size) ? core_size : topology_bits((result.c & 0xFF) + 1);
+    }
+
+    if (max_ext >= TOPOLOGY_LEAF_EXT_TOPOLOGY) {
+        cpu_cpuid(TOPOLOGY_LEAF_EXT_FEATURES, &result);
+
+        if (0 != (result.c & (1 << 22))) {
+            cpu_cpuid(TOPOLOGY_LEAF_EXT_TOPOLOGY, &result);
+            *smt_shift = topology_bits(((result.b >> 8) & 0xFF) + 1);
+        }
+    }
+}
+
+/**
+ * Records the caches of the current CPU from the deterministic cache parameter
+ * leaf <leaf> (4 or 0x8000001D).
+ *
+ * @param leaf the cache parameter leaf
+ * @param caches the list of caches to fill
+ */
+static void topology_decode_caches(uint32_t leaf, topology_cache_t *caches)
+{
+    cpu_cpuid_result_t result;
+    size_t count = 0;
+    uint32_t subleaf;
+
+    for (subleaf = 0; count < TOPOLOGY_CACHE_MAX; ++subleaf) {
+        cpu_cpuid_sub(leaf, subleaf, &result);
+
+        uint32_t type = result.a & 0x1F;
+        if (0 == type)
+            break;
+
+        // Skip cache types unknown to the info table
+        if (type > HY_INFO_CACHE_TYPE_UNIFIED)
+            continue;
+
+        topology_cache_t *cache = &caches[count++];
+        cache->level = (result.a >> 5) & 0x7;
+        cache->type = type;
+        cache->flags = 0;
+        cache->line_size = (result.b & 0xFFF) + 1;
+        cache->ways = ((result.b >> 22) & 0x3FF) + 1;
+        cache->sets = result.c + 1;
+        cache->share_shift = topology_bits(((result.a >> 14) & 0xFFF) + 1);
+
+        // The line partitions are folded into the number of ways
+        cache->ways *= ((result.b >> 12) & 0x3FF) + 1;
+
+        if (0 != (result.a & (1 << 9)))
+            cache->flags |= HY_INFO_CACHE_FLAG_FULLY_ASSOC;
+
+        if (0 != (result.d & (1 << 1)))
+            cache->flags |= HY_INFO_CACHE_FLAG_INCLUSIVE;
+    }
+}
+
+/**
+ * Builds the cache table from the recorded caches and links the CPUs to their
+ * caches, or only counts the cache instances.
+ *
+ * CPUs sharing a cache have the same APIC id apart from the lowest share_shift
+ * bits, so they are adjacent in the APIC id index.
+ *
+ * @param fill whether to fill the cache table (otherwise only count)
+ * @return the number of cache instances
+ */
+static size_t topology_cache_build(uint8_t fill)
+{
+    size_t last_entry[TOPOLOGY_CACHE_KEYS];
+    uint32_t last_id[TOPOLOGY_CACHE_KEYS];
+    uint32_t last_shift[TOPOLOGY_CACHE_KEYS];
+    size_t count = 0;
+    size_t i, j;
+
+    for (i = 0; i < TOPOLOGY_CACHE_KEYS; ++i)
+        last_entry[i] = HY_INFO_CACHE_NONE;
+
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        size_t cpu_index = info_cpu_index[i].index;
+        hy_info_cpu_t *cpu = &info_cpu[cpu_index];
+        topology_cache_t *caches = &topology_caches[cpu_index * TOPOLOGY_CACHE_MAX];
+
+        if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
+            continue;
+
+        if (fill) {
+            cpu->cache_l1d = HY_INFO_CACHE_NONE;
+            cpu->cache_l1i = HY_INFO_CACHE_NONE;
+            cpu->cache_l2 = HY_INFO_CACHE_NONE;
+            cpu->cache_llc = HY_INFO_CACHE_NONE;
+        }
+
+        uint8_t llc_level = 0;
+
+        for (j = 0; j < TOPOLOGY_CACHE_MAX && 0 != caches[j].level; ++j) {
+            topology_cache_t *cache = &caches[j];
+            size_t key = TOPOLOGY_CACHE_KEY(cache);
+            uint32_t id = cpu->apic_id >> cache->share_shift;
+            size_t entry = last_entry[key];
+
+            // Start a new instance unless shared with the last one of its kind
+            if (HY_INFO_CACHE_NONE == entry || id != last_id[key] || cache->share_shift != last_shift[key]) {
+                entry = count++;
+                last_entry[key] = entry;
+                last_id[key] = id;
+                last_shift[key] = cache->share_shift;
+
+                if (fill) {
+                    hy_info_cache_t *instance = &info_cache[entry];
+                    instance->level = cache->level;
+                    instance->type = cache->type;
+                    instance->flags = cache->flags;
+                    instance->line_size = cache->line_size;
+                    instance->ways = cache->ways;
+                    instance->sets = cache->sets;
+                    instance->size = (uint64_t) cache->line_size * cache->ways * cache->sets;
+                    instance->cpu_first = i;
+                }
+            }
+
+            if (!fill)
+                continue;
+
+            info_cache[entry].cpu_count = i - info_cache[entry].cpu_first + 1;
+
+            // Link the CPU to its caches
+            if (1 == cache->level && HY_INFO_CACHE_TYPE_INSTRUCTION == cache->type) {
+                cpu->cache_l1i = entry;
+            } else if (1 == cache->level) {
+                cpu->cache_l1d = entry;
+            } else if (2 == cache->level && HY_INFO_CACHE_TYPE_INSTRUCTION != cache->type) {
+                cpu->cache_l2 = entry;
+            }
+
+            if (HY_INFO_CACHE_TYPE_INSTRUCTION != cache->type && cache->level >= llc_level) {
+                cpu->cache_llc = entry;
+                llc_level = cache->level;
+            }
+        }
+    }
+
+    return count;
+}
+
+void topology_init(void)
+{
+    size_t size = sizeof(topology_cache_t) * TOPOLOGY_CACHE_MAX * info_root->cpu_count;
+
+    topology_caches = (topology_cache_t *) heap_alloc(size);
+    memset(topology_caches, 0, size);
+}
+
+void topology_detect(void)
+{
+    size_t index = lapic_cpu_index();
+    hy_info_cpu_t *cpu = &info_cpu[index];
+    cpu_cpuid_result_t result;
+
+    cpu_cpuid(0x00, &result);
+    uint32_t max_leaf = result.a;
+
+    // Determine how the APIC id is split into the topology ids
+    uint32_t smt_shift, die_shift, package_shift;
+
+    if (!(max_leaf >= TOPOLOGY_LEAF_V2 &&
+            topology_decode_extended(TOPOLOGY_LEAF_V2, &smt_shift, &die_shift, &package_shift)) &&
+        !(max_leaf >= TOPOLOGY_LEAF_X2APIC &&
+            topology_decode_extended(TOPOLOGY_LEAF_X2APIC, &smt_shift, &die_shift, &package_shift))) {
+        topology_decode_legacy(max_leaf, &smt_shift, &package_shift);
+        die_shift = package_shift;
+    }
+
+    // The ids are system-wide unique, i.e. they include the higher levels
+    uint32_t apic_id = cpu->apic_id;
+
+    cpu->smt_id = apic_id & ((1u << smt_shift) - 1);
+    cpu->core_id = apic_id >> smt_shift;
+    cpu->die_id = apic_id >> die_shift;
+    cpu->package_id = apic_id >> package_shift;
+
+    // Determine the core type on hybrid processors
+    cpu->core_type = 0;
+
+    if (max_leaf >= TOPOLOGY_LEAF_HYBRID) {
+        cpu_cpuid_sub(TOPOLOGY_LEAF_FEATURES, 0, &result);
+
+        if (0 != (result.d & (1 << 15))) {
+            cpu_cpuid_sub(TOPOLOGY_LEAF_HYBRID, 0, &result);
+            cpu->core_type = (result.a >> 24) & 0xFF;
+        }
+    }
+
+    // Record the caches (Intel: leaf 4, AMD: leaf 0x8000001D with TOPOEXT)
+    topology_cache_t *caches = &topology_caches[index * TOPOLOGY_CACHE_MAX];
+
+    if (max_leaf >= TOPOLOGY_LEAF_CACHE) {
+        cpu_cpuid_sub(TOPOLOGY_LEAF_CACHE, 0, &result);
+
+        if (0 != (result.a & 0x1F)) {
+            topology_decode_caches(TOPOLOGY_LEAF_CACHE, caches);
+            return;
+        }
+    }
+
+    cpu_cpuid(0x80000000, &result);
+
+    if (result.a >= TOPOLOGY_LEAF_EXT_CACHE) {
+        cpu_cpuid(TOPOLOGY_LEAF_EXT_FEATURES, &result);
+
+        if (0 != (result.c & (1 << 22)))
+            topology_decode_caches(TOPOLOGY_LEAF_EXT_CACHE, caches);
+    }
+}
+
+void topology_index(void)
+{
+    size_t i;
+    uint32_t core_count = 0;
+    uint32_t package_count = 0;
+    uint32_t last_core = 0;
+    uint32_t last_package = 0;
+
+    // The core and package ids are monotonic in the APIC id, so walking the
+    // CPUs in the order of the APIC id index yields dense indices
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        hy_info_cpu_t *cpu = &info_cpu[info_cpu_index[i].index];
+
+        if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
+            continue;
+
+        if (0 == package_count || cpu->package_id != last_package) {
+            last_package = cpu->package_id;
+            ++package_count;
+        }
+
+        if (0 == core_count || cpu->core_id != last_core) {
+            last_core = cpu->core_id;
+            ++core_count;
+        }
+
+        cpu->core_index = core_count - 1;
+        cpu->package_index = package_count - 1;
+    }
+
+    info_root->core_count = core_count;
+    info_root->package_count = package_count;
+
+    // Count the cache instances, then build the cache table
+    size_t cache_count = topology_cache_build(0);
+
+    info_cache_alloc(cache_count);
+    info_root->cache_count = topology_cache_build(1);
+}
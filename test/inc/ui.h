@@ -29,7 +29,7 @@
 /**
  * Number of pages in the UI.
  */
-#define UI_PAGE_COUNT 5
+#define UI_PAGE_COUNT 8
 
 /**
  * Structure describing a page.
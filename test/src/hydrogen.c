@@ -24,12 +24,15 @@
  */
 
 #include <hydrogen.h>
+#include <info.h>
 #include <isr.h>
 #include <keyboard.h>
 
 #define FLAGS                          (    \
     HY_HEADER_FLAG_IOAPIC_BSP           |    \
-    HY_HEADER_FLAG_X2APIC_ALLOW         )
+    HY_HEADER_FLAG_X2APIC_ALLOW         |    \
+    HY_HEADER_FLAG_SSE_ENABLE           |    \
+    HY_HEADER_FLAG_XSAVE_ENABLE         )
 
 hy_header_root_t hydrogen_header = {
         HY_MAGIC,                               // magic
@@ -59,5 +62,24 @@ hy_header_root_t hydrogen_header = {
                 {HY_HEADER_IRQ_FLAG_MASK, 0},   // IRQ13
                 {HY_HEADER_IRQ_FLAG_MASK, 0},   // IRQ14
                 {HY_HEADER_IRQ_FLAG_MASK, 0}    // IRQ15
-        }
+        },
+
+        0x4000,                                 // stack_size
+        1,                                      // stack_guard
+
+        0,                                      // percpu_size
+        0,                                      // percpu_align
+        0,                                      // percpu_template
+        0,                                      // percpu_template_size
+        0,                                      // percpu_vaddr
+
+        HY_INFO_VERSION_2,                      // info_version
+
+        0x7,                                    // xcr0_mask (x87, SSE, AVX)
+
+        HY_HEADER_IRQ_POLICY_DEFAULT,           // irq_policy
+        0,                                      // irq_cpu_count
+        0                                       // irq_cpu_table
 };
+
+hy_info_root_v2_t *info_root = 0;
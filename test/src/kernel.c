@@ -25,6 +25,7 @@
 
 #include <buffer.h>
 #include <hydrogen.h>
+#include <info.h>
 #include <isr.h>
 #include <keyboard.h>
 #include <screen.h>
@@ -41,7 +42,7 @@ static char *build_overview(char *buffer)
     ui_pages[0].title = "Overview";
     ui_pages[0].body = buffer;
 
-    hy_info_root_t *root = HY_INFO_ROOT;
+    hy_info_root_v2_t *root = info_root;
 
     BSTR("Welcome to the H2 Test Utility.\n");
     BSTR("Use LEFT and RIGHT to switch between pages, and UP and DOWN to scroll.\n\n");
@@ -53,6 +54,22 @@ static char *build_overview(char *buffer)
     BSTR(pic ? "Yes" : "No");
     BSTR("\nx2APIC present:     ");
     BSTR(x2apic ? "Yes" : "No");
+
+    hy_info_cpu_features_t *features = INFO_TABLE(cpu_features_common, hy_info_cpu_features_t);
+    bool heterogeneous = (0 != (root->flags & HY_INFO_FLAG_HETEROGENEOUS));
+    bool invariant_tsc = (0 != (features->power_edx & (1 << 8)));
+    bool mwait = (0 != (features->basic_ecx & (1 << 3)));
+
+    BSTR("\nHeterogeneous CPUs: ");
+    BSTR(heterogeneous ? "Yes" : "No");
+    BSTR("\nInvariant TSC:      ");
+    BSTR(invariant_tsc ? "Yes" : "No");
+    BSTR("\nMONITOR/MWAIT:      ");
+    BSTR(mwait ? "Yes" : "No");
+    BSTR("\nXCR0:               ");
+    BNUM(root->xcr0);
+    BSTR("\nXSAVE Area Size:    ");
+    BNUM(root->xsave_size);
     BSTR("\n\n");
 
     BSTR("LAPIC MMIO:         ");
@@ -61,6 +78,8 @@ static char *build_overview(char *buffer)
     BNUM(root->rsdp_paddr);
     BSTR("\nFirst Free Address: ");
     BNUM(root->free_paddr);
+    BSTR("\nIdentity Mapped:    ");
+    BNUM(root->identity_length);
     BSTR("\n\n");
 
     return buffer;
@@ -72,8 +91,8 @@ static char *build_cpu(char *buffer)
     ui_pages[1].body = buffer;
 
     size_t i;
-    for (i = 0; i < HY_INFO_ROOT->cpu_count; ++i) {
-        hy_info_cpu_t *cpu = &(HY_INFO_CPU[i]);
+    for (i = 0; i < info_root->cpu_count; ++i) {
+        hy_info_cpu_t *cpu = &(INFO_TABLE(cpu, hy_info_cpu_t)[i]);
 
         if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
             continue;
@@ -85,11 +104,56 @@ static char *build_cpu(char *buffer)
         BSTR("\nLAPIC Timer Freq.: ");
         BNUM(cpu->lapic_timer_freq);
         BSTR(" Hz");
+        BSTR("\nTSC Freq.:         ");
+        BNUM(cpu->tsc_freq);
+        BSTR(" Hz");
         BSTR("\nNUMA domain:       ");
         BNUM(cpu->domain);
+        BSTR("\nCluster/Logical:   ");
+        BNUM(cpu->cluster);
+        BSTR(" / ");
+        BNUM(cpu->logical_id);
+        BSTR("\nPackage/Die/Core:  ");
+        BNUM(cpu->package_id);
+        BSTR(" / ");
+        BNUM(cpu->die_id);
+        BSTR(" / ");
+        BNUM(cpu->core_id);
+        BSTR("\nSMT ID:            ");
+        BNUM(cpu->smt_id);
+        BSTR("\nCore Index:        ");
+        BNUM(cpu->core_index);
+        BSTR(" (package ");
+        BNUM(cpu->package_index);
+        BSTR(")\nL1d/L1i/L2/LLC:    ");
+        BNUM(cpu->cache_l1d);
+        BSTR(" / ");
+        BNUM(cpu->cache_l1i);
+        BSTR(" / ");
+        BNUM(cpu->cache_l2);
+        BSTR(" / ");
+        BNUM(cpu->cache_llc);
+        BSTR("\nCore Type:         ");
+
+        if (HY_INFO_CPU_CORE_TYPE_ATOM == cpu->core_type) {
+            BSTR("Efficiency");
+        } else if (HY_INFO_CPU_CORE_TYPE_CORE == cpu->core_type) {
+            BSTR("Performance");
+        } else {
+            BSTR("-");
+        }
+
         BSTR("\n\n");
     }
 
+    BSTR("Cores:             ");
+    BNUM(info_root->core_count);
+    BSTR("\nPackages:          ");
+    BNUM(info_root->package_count);
+    BSTR("\nLogical Clusters:  ");
+    BNUM(info_root->cluster_count);
+    BSTR("\n");
+
     return buffer;
 }
 
@@ -99,8 +163,8 @@ static char *build_ioapic(char *buffer)
     ui_pages[2].body = buffer;
 
     size_t i;
-    for (i = 0; i < HY_INFO_ROOT->ioapic_count; ++i) {
-        hy_info_ioapic_t *ioapic = &(HY_INFO_IOAPIC[i]);
+    for (i = 0; i < info_root->ioapic_count; ++i) {
+        hy_info_ioapic_t *ioapic = &(INFO_TABLE(ioapic, hy_info_ioapic_t)[i]);
 
         BSTR("APIC ID:      ");
         BNUM(ioapic->apic_id);
@@ -115,6 +179,22 @@ static char *build_ioapic(char *buffer)
         BSTR("\n\n");
     }
 
+    uint32_t *gsi_cpu = INFO_TABLE(gsi_cpu, uint32_t);
+
+    for (i = 0; i < info_root->gsi_count; ++i) {
+        BSTR("GSI ");
+        BNUM(i);
+        BSTR(" -> ");
+
+        if (HY_INFO_GSI_CPU_NONE == gsi_cpu[i]) {
+            BSTR("any CPU\n");
+        } else {
+            BSTR("APIC ");
+            BNUM(INFO_TABLE(cpu, hy_info_cpu_t)[gsi_cpu[i]].apic_id);
+            BSTR("\n");
+        }
+    }
+
     return buffer;
 }
 
@@ -124,8 +204,8 @@ static char *build_memory(char *buffer)
     ui_pages[3].body = buffer;
 
     size_t i;
-    for (i = 0; i < HY_INFO_ROOT->mmap_count; ++i) {
-        hy_info_mmap_t *mmap = &HY_INFO_MMAP[i];
+    for (i = 0; i < info_root->mmap_count; ++i) {
+        hy_info_mmap_t *mmap = &INFO_TABLE(mmap, hy_info_mmap_t)[i];
 
         BSTR("Address:   ");
         BNUM(mmap->address);
@@ -133,6 +213,31 @@ static char *build_memory(char *buffer)
         BNUM(mmap->length);
         BSTR("\nAvailable: ");
         BSTR((1 == mmap->available) ? "Yes" : "No");
+        BSTR("\nModule:    ");
+        BSTR((0 != (mmap->flags & HY_INFO_MMAP_FLAG_MODULE)) ? "Yes" : "No");
+        BSTR("\nPaging:    ");
+        BSTR((0 != (mmap->flags & HY_INFO_MMAP_FLAG_PAGING)) ? "Yes" : "No");
+        BSTR("\nDomain:    ");
+
+        if (HY_INFO_MMAP_DOMAIN_NONE == mmap->domain) {
+            BSTR("None\n\n");
+        } else {
+            BNUM(mmap->domain);
+            BSTR("\n\n");
+        }
+    }
+
+    for (i = 0; i < info_root->numa_mem_count; ++i) {
+        hy_info_numa_mem_t *mem = &INFO_TABLE(numa_mem, hy_info_numa_mem_t)[i];
+
+        BSTR("NUMA Range: ");
+        BNUM(mem->address);
+        BSTR("\nLength:     ");
+        BNUM(mem->length);
+        BSTR("\nDomain:     ");
+        BNUM(mem->domain);
+        BSTR("\nHotplug:    ");
+        BSTR((0 != (mem->flags & HY_INFO_NUMA_MEM_FLAG_HOTPLUG)) ? "Yes" : "No");
         BSTR("\n\n");
     }
 
@@ -145,11 +250,11 @@ static char *build_modules(char *buffer)
     ui_pages[4].body = buffer;
 
     size_t i;
-    for (i = 0; i < HY_INFO_ROOT->module_count; ++i) {
-        hy_info_module_t *mod = &HY_INFO_MODULE[i];
+    for (i = 0; i < info_root->module_count; ++i) {
+        hy_info_module_v2_t *mod = &INFO_TABLE(module, hy_info_module_v2_t)[i];
 
         BSTR("Name:    ");
-        BSTR(&HY_INFO_STRING[mod->name]);
+        BSTR(&INFO_TABLE(string, char)[mod->name]);
         BSTR("\nAddress: ");
         BNUM(mod->address);
         BSTR("\nLength:  ");
@@ -160,6 +265,163 @@ static char *build_modules(char *buffer)
     return buffer;
 }
 
+static char *build_boot(char *buffer)
+{
+    ui_pages[5].title = "Boot Timeline";
+    ui_pages[5].body = buffer;
+
+    hy_info_root_v2_t *root = info_root;
+
+    BSTR("Pages Mapped:  ");
+    BNUM(root->pages_mapped);
+    BSTR("\nMap Ticks:     ");
+    BNUM(root->map_cycles);
+    BSTR("\nTicks/Page:    ");
+    BNUM((0 == root->pages_mapped) ? 0 : root->map_cycles / root->pages_mapped);
+    BSTR("\nBytes Copied:  ");
+    BNUM(root->bytes_copied);
+    BSTR("\nCopy Ticks:    ");
+    BNUM(root->copy_cycles);
+    BSTR("\nBytes/100 Tck: ");
+    BNUM((0 == root->copy_cycles) ? 0 : root->bytes_copied * 100 / root->copy_cycles);
+    BSTR("\nHeap Used:     ");
+    BNUM(root->heap_used);
+    BSTR("\n\n");
+
+    size_t i;
+    uint64_t last_tsc = root->boot_tsc;
+    for (i = 0; i < root->phase_count; ++i) {
+        hy_info_phase_v2_t *phase = &INFO_TABLE(phase, hy_info_phase_v2_t)[i];
+
+        BSTR("Phase:         ");
+        BSTR(&INFO_TABLE(string, char)[phase->name]);
+        BSTR("\nTicks:         ");
+        BNUM(phase->tsc - last_tsc);
+        BSTR("\n\n");
+
+        last_tsc = phase->tsc;
+    }
+
+    for (i = 0; i < root->cpu_count; ++i) {
+        hy_info_cpu_t *cpu = &INFO_TABLE(cpu, hy_info_cpu_t)[i];
+        hy_info_milestone_t *milestone = &INFO_TABLE(milestone, hy_info_milestone_t)[i];
+
+        if (0 == (cpu->flags & HY_INFO_CPU_FLAG_PRESENT))
+            continue;
+
+        if (0 != (cpu->flags & HY_INFO_CPU_FLAG_BSP))
+            continue;
+
+        BSTR("AP APIC ID:    ");
+        BNUM(cpu->apic_id);
+        BSTR("\nLong Mode:     ");
+        BNUM(milestone->entry_tsc - milestone->trampoline_tsc);
+        BSTR("\nCalibrated:    ");
+        BNUM(milestone->calibrated_tsc - milestone->trampoline_tsc);
+        BSTR("\nReleased:      ");
+        BNUM(milestone->release_tsc - milestone->trampoline_tsc);
+        BSTR("\n\n");
+    }
+
+    for (i = 0; i < root->cpu_count; ++i) {
+        hy_info_cpu_t *cpu = &INFO_TABLE(cpu, hy_info_cpu_t)[i];
+        hy_info_work_t *work = &INFO_TABLE(work, hy_info_work_t)[i];
+
+        if (0 == work->jobs)
+            continue;
+
+        BSTR("Work APIC ID:  ");
+        BNUM(cpu->apic_id);
+        BSTR("\nJobs:          ");
+        BNUM(work->jobs);
+        BSTR("\nBytes:         ");
+        BNUM(work->bytes);
+        BSTR("\nTicks:         ");
+        BNUM(work->cycles);
+        BSTR("\n\n");
+    }
+
+    return buffer;
+}
+
+static char *build_numa(char *buffer)
+{
+    ui_pages[6].title = "NUMA";
+    ui_pages[6].body = buffer;
+
+    hy_info_root_v2_t *root = info_root;
+    size_t domains = root->numa_domain_count;
+
+    BSTR("NUMA Domains:  ");
+    BNUM(domains);
+    BSTR("\n\n");
+
+    size_t from, to;
+    for (from = 0; from < domains; ++from) {
+        for (to = 0; to < domains; ++to) {
+            BSTR("From/To:       ");
+            BNUM(from);
+            BSTR(" / ");
+            BNUM(to);
+
+            if (0 != root->numa_distance_offset) {
+                BSTR("\nDistance:      ");
+                BNUM(INFO_TABLE(numa_distance, uint8_t)[from * domains + to]);
+            }
+
+            if (0 != root->numa_perf_offset) {
+                hy_info_numa_perf_t *perf = &INFO_TABLE(numa_perf, hy_info_numa_perf_t)[from * domains + to];
+
+                BSTR("\nRead Latency:  ");
+                BNUM(perf->read_latency);
+                BSTR(" ps\nWrite Latency: ");
+                BNUM(perf->write_latency);
+                BSTR(" ps\nRead BW:       ");
+                BNUM(perf->read_bandwidth);
+                BSTR(" MB/s\nWrite BW:      ");
+                BNUM(perf->write_bandwidth);
+                BSTR(" MB/s");
+            }
+
+            BSTR("\n\n");
+        }
+    }
+
+    return buffer;
+}
+
+static char *build_caches(char *buffer)
+{
+    ui_pages[7].title = "Caches";
+    ui_pages[7].body = buffer;
+
+    static const char *types[] = { "-", "Data", "Instruction", "Unified" };
+
+    size_t i;
+    for (i = 0; i < info_root->cache_count; ++i) {
+        hy_info_cache_t *cache = &INFO_TABLE(cache, hy_info_cache_t)[i];
+
+        BSTR("Level/Type:   L");
+        BNUM(cache->level);
+        BSTR(" ");
+        BSTR(types[cache->type & 0x3]);
+        BSTR("\nSize:         ");
+        BNUM(cache->size);
+        BSTR(" bytes");
+        BSTR("\nLine/Ways:    ");
+        BNUM(cache->line_size);
+        BSTR(" / ");
+        BNUM(cache->ways);
+        BSTR("\nCPUs:         ");
+        BNUM(cache->cpu_first);
+        BSTR(" + ");
+        BNUM(cache->cpu_count);
+        BSTR(" (APIC id index)\n\n");
+    }
+
+    return buffer;
+}
+
 static void fault_gp(isr_state_t *state)
 {
     char buffer_data[50];
@@ -169,21 +431,26 @@ static void fault_gp(isr_state_t *state)
     screen_write(buffer, 10, 20);
 }
 
-void kmain_bsp(void);
-void kmain_bsp(void)
+void kmain_bsp(hy_info_root_v2_t *root);
+void kmain_bsp(hy_info_root_v2_t *root)
 {
+    info_root = root;
+
     size_t i = 0;
     for (i = 0; i < 256; ++i) {
         isr_handlers[i] = (uintptr_t) &fault_gp;
     }
     isr_handlers[KEYBOARD_IRQ_VECTOR] = (uintptr_t) &keyboard_handler;
 
-    char *buffer = (char *) HY_INFO_ROOT->free_paddr;
+    char *buffer = (char *) info_root->free_paddr;
     buffer = build_overview(buffer);
     buffer = build_cpu(&buffer[1]);
     buffer = build_ioapic(&buffer[1]);
     buffer = build_memory(&buffer[1]);
     buffer = build_modules(&buffer[1]);
+    buffer = build_boot(&buffer[1]);
+    buffer = build_numa(&buffer[1]);
+    buffer = build_caches(&buffer[1]);
 
     ui_display(0, 0);
     asm volatile ("sti");